@@ -9,11 +9,32 @@
 #include <fcntl.h>
 #include <utime.h>
 #include <limits.h>
-#include "header.h"  // prototypes for arrange_directory, log_event
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include "header.h"  // prototypes for arrange_directory, log_event, pool_submit
+
+#define DEST_LOCKS 64   // copies to the same destination are serialized
 
 extern daemon_config_t *current_cfg;
 extern bool current_first_run;
 
+static pthread_mutex_t dest_locks[DEST_LOCKS];
+static pthread_once_t dest_locks_once = PTHREAD_ONCE_INIT;
+
+// Helper: initialize the destination locks
+static void init_dest_locks(void) {
+    for (int i = 0; i < DEST_LOCKS; i++) pthread_mutex_init(&dest_locks[i], NULL);
+}
+
+// Helper: lock guarding one destination path (a.txt from two directories)
+static pthread_mutex_t *dest_lock(const char *dest_path) {
+    unsigned h = 5381;
+    for (const char *p = dest_path; *p; p++) h = h * 33 + (unsigned char)*p;
+    pthread_once(&dest_locks_once, init_dest_locks);
+    return &dest_locks[h % DEST_LOCKS];
+}
+
 // Helper: get file extension (without dot), or empty string if none
 static const char* get_extension(const char *filename) {
     const char *dot = strrchr(filename, '.');
@@ -43,6 +64,184 @@ static int copy_file(const char *src, const char *dst, mode_t mode) {
     return 0;
 }
 
+// Helper: clone src into dst with ioctl(FICLONE); -1 with errno set on failure
+static int clone_file(const char *src, const char *dst, mode_t mode) {
+    int infd = open(src, O_RDONLY);
+    if (infd < 0) return -1;
+    int outfd = open(dst, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (outfd < 0) { close(infd); return -1; }
+    int ret = ioctl(outfd, FICLONE, infd);
+    int err = errno;
+    close(infd);
+    close(outfd);
+    errno = err;
+    return ret < 0 ? -1 : 0;
+}
+
+// Helper: hard link src as dst, replacing a kept duplicate atomically
+static int link_file(const char *src, const char *dst) {
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.ssu_cleanupd.tmp", dst);
+    unlink(tmp);
+    if (link(src, tmp) < 0) return -1;
+    if (rename(tmp, dst) < 0) {
+        int err = errno;
+        unlink(tmp);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+// Helper: put src at dst with the given method; data is only copied
+// across filesystems (or where reflinks are not supported)
+static int place_file(const char *src, const char *dst, const struct stat *st, int method) {
+    struct utimbuf times = { st->st_atime, st->st_mtime };
+    if (method == ARRANGE_MOVE) {
+        if (rename(src, dst) == 0) return 0;
+        if (errno != EXDEV) return -1;
+        // other filesystem: copy, then remove the source
+        if (copy_file(src, dst, st->st_mode & 0777) < 0) return -1;
+        utime(dst, &times);
+        return unlink(src);
+    }
+    if (method == ARRANGE_LINK) {
+        // same inode: times are already the source's
+        if (link_file(src, dst) == 0) return 0;
+        if (errno != EXDEV) return -1;
+    } else if (method == ARRANGE_REFLINK) {
+        if (clone_file(src, dst, st->st_mode & 0777) == 0) {
+            utime(dst, &times);
+            return 0;
+        }
+        if (errno != EXDEV && errno != EOPNOTSUPP && errno != EINVAL && errno != ENOTTY)
+            return -1;
+    }
+    if (copy_file(src, dst, st->st_mode & 0777) < 0) return -1;
+    // Preserve modification time
+    utime(dst, &times);
+    return 0;
+}
+
+// Helper: daemon's own files (config, log, state) in the monitored directory
+static int is_daemon_file(const char *name) {
+    return strncmp(name, "ssu_cleanupd.", strlen("ssu_cleanupd.")) == 0;
+}
+
+// Helper: check if path is under one of the excluded directories
+static int is_excluded(const char *path, char **exclude_paths, int exclude_count) {
+    for (int i = 0; i < exclude_count; i++) {
+        if (strncmp(path, exclude_paths[i], strlen(exclude_paths[i])) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Helper: split comma-separated extensions; all_ext set when none are given
+static char **parse_extensions(const char *extensions_str, int *ext_count, int *all_ext) {
+    char **ext_list = NULL;
+    *ext_count = 0;
+    *all_ext = 0;
+    if (!extensions_str || strlen(extensions_str) == 0) {
+        *all_ext = 1;
+        return NULL;
+    }
+    char *exts = strdup(extensions_str);
+    char *token = strtok(exts, ",");
+    while (token) {
+        ext_list = realloc(ext_list, sizeof(char*) * (*ext_count + 1));
+        ext_list[(*ext_count)++] = strdup(token);
+        token = strtok(NULL, ",");
+    }
+    free(exts);
+    if (*ext_count == 0) *all_ext = 1;
+    return ext_list;
+}
+
+// Arrange one regular file into dst/<extension>/
+static void arrange_file(const char *src_path,
+                         const char *name,
+                         const struct stat *st,
+                         const char *dst,
+                         char **ext_list,
+                         int ext_count,
+                         int all_ext,
+                         int mode) {
+    // Extension filter
+    const char *ext = get_extension(name);
+    int match = all_ext;
+    if (strcmp(ext, "log") == 0) return;
+    if (!all_ext) {
+        for (int i = 0; i < ext_count; i++) {
+            if (strcmp(ext_list[i], ext) == 0) {
+                match = 1; break;
+            }
+        }
+    }
+    if (!match) return;
+    // Prepare dest directory for this extension
+    char ext_dirname[NAME_MAX + 1];
+    if (ext[0] != '\0') snprintf(ext_dirname, sizeof(ext_dirname), "%s", ext);
+    else strncpy(ext_dirname, "others", sizeof(ext_dirname));
+    char dest_dir[PATH_MAX];
+    snprintf(dest_dir, sizeof(dest_dir), "%s/%s", dst, ext_dirname);
+    // Prepare dest file path
+    char dest_path[PATH_MAX];
+    snprintf(dest_path, sizeof(dest_path), "%s/%s", dest_dir, name);
+    // Already handled and unchanged since: no stat of the destination
+    if (state_unchanged(st, dest_path)) return;
+    pool_submit(src_path, dest_dir, dest_path, st, mode);
+}
+
+/**
+ * Copy (or clone, link, move) one file to 'dest_path' unless the duplicate
+ * mode keeps the file already there; runs on a copy worker
+ */
+void arrange_copy(const char *src_path,
+                  const char *dest_dir,
+                  const char *dest_path,
+                  const struct stat *st,
+                  int mode) {
+    int method = current_cfg ? current_cfg->method : ARRANGE_COPY;
+    pthread_mutex_t *lock = dest_lock(dest_path);
+    pthread_mutex_lock(lock);
+    if (mkdir(dest_dir, 0755) < 0 && errno != EEXIST) {
+        pthread_mutex_unlock(lock);
+        return;
+    }
+    // Duplicate handling
+    int do_copy = 1;
+    struct stat dst_st;
+    if (stat(dest_path, &dst_st) == 0) {
+        if (dst_st.st_dev == st->st_dev && dst_st.st_ino == st->st_ino) {
+            // Already linked
+            do_copy = 0;
+        } else if (mode == 1) {
+            // Keep newest
+            if (st->st_mtime <= dst_st.st_mtime) do_copy = 0;
+        } else if (mode == 2) {
+            // Keep oldest
+            if (st->st_mtime >= dst_st.st_mtime) do_copy = 0;
+        } else if (mode == 3) {
+            // Skip duplicates
+            do_copy = 0;
+        }
+    }
+    if (!do_copy) {
+        pthread_mutex_unlock(lock);
+        state_record(st, dest_path);
+        return;
+    }
+    if (place_file(src_path, dest_path, st, method) < 0) {
+        pthread_mutex_unlock(lock);
+        return;
+    }
+    pthread_mutex_unlock(lock);
+    // a moved file is no longer in the monitored directory
+    if (method != ARRANGE_MOVE) state_record(st, dest_path);
+    if(!current_first_run) log_event(current_cfg, src_path, dest_path);
+}
+
 // Recursive scan and arrange
 static void scan_dir(const char *base_src,
                      const char *curr_src,
@@ -57,7 +256,7 @@ static void scan_dir(const char *base_src,
     if (!dir) return;
     struct dirent *entry;
     while ((entry = readdir(dir))) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 || strcmp(entry->d_name, "ssu_cleanupd.config") == 0 || strcmp(entry->d_name, "ssu_cleanud.log") == 0)
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 || is_daemon_file(entry->d_name))
             continue;
         // Build full source path
         char src_path[PATH_MAX];
@@ -66,67 +265,15 @@ static void scan_dir(const char *base_src,
         if (lstat(src_path, &st) < 0) continue;
         if (S_ISDIR(st.st_mode)) {
             // Check exclude paths
-            int excluded = 0;
-            for (int i = 0; i < exclude_count; i++) {
-                if (strncmp(src_path, exclude_paths[i], strlen(exclude_paths[i])) == 0) {
-                    excluded = 1;
-                    break;
-                }
-            }
-            if (!excluded) {
+            if (!is_excluded(src_path, exclude_paths, exclude_count)) {
                 scan_dir(base_src, src_path, dst,
                          exclude_paths, exclude_count,
                          ext_list, ext_count, all_ext, mode);
             }
         }
         else if (S_ISREG(st.st_mode)) {
-            // Extension filter
-            const char *ext = get_extension(entry->d_name);
-            int match = all_ext;
-            
-            const char *ext0 = get_extension(entry->d_name);
-            if(strcmp(ext0,"log") == 0) continue;
-
-            if (!all_ext) {
-                for (int i = 0; i < ext_count; i++) {
-                    if (strcmp(ext_list[i], ext) == 0) {
-                        match = 1; break;
-                    }
-                }
-            }
-            if (!match) continue;
-            // Prepare dest directory for this extension
-            char ext_dirname[NAME_MAX + 1];
-            if (ext[0] != '\0') snprintf(ext_dirname, sizeof(ext_dirname), "%s", ext);
-            else strncpy(ext_dirname, "others", sizeof(ext_dirname));
-            char dest_dir[PATH_MAX];
-            snprintf(dest_dir, sizeof(dest_dir), "%s/%s", dst, ext_dirname);
-            if (mkdir(dest_dir, 0755) < 0 && errno != EEXIST) continue;
-            // Prepare dest file path
-            char dest_path[PATH_MAX];
-            snprintf(dest_path, sizeof(dest_path), "%s/%s", dest_dir, entry->d_name);
-            // Duplicate handling
-            int do_copy = 1;
-            struct stat dst_st;
-            if (stat(dest_path, &dst_st) == 0) {
-                if (mode == 1) {
-                    // Keep newest
-                    if (st.st_mtime <= dst_st.st_mtime) do_copy = 0;
-                } else if (mode == 2) {
-                    // Keep oldest
-                    if (st.st_mtime >= dst_st.st_mtime) do_copy = 0;
-                } else if (mode == 3) {
-                    // Skip duplicates
-                    do_copy = 0;
-                }
-            }
-            if (!do_copy) continue;
-            // Copy file
-            if (copy_file(src_path, dest_path, st.st_mode & 0777) < 0) continue;
-            // Preserve modification time
-            struct utimbuf times = { st.st_atime, st.st_mtime };
-            utime(dest_path, &times);
-            if(!current_first_run) log_event(current_cfg, src_path, dest_path);
+            arrange_file(src_path, entry->d_name, &st, dst,
+                         ext_list, ext_count, all_ext, mode);
         }
     }
     closedir(dir);
@@ -142,30 +289,58 @@ void arrange_directory(const char *src,
                        const char *extensions_str,
                        int mode) {
     // Parse extensions list
-    char **ext_list = NULL;
-    int ext_count = 0;
-    int all_ext = 0;
-    if (!extensions_str || strlen(extensions_str) == 0) {
-        all_ext = 1;
-    } else {
-        char *exts = strdup(extensions_str);
-        char *token = strtok(exts, ",");
-        while (token) {
-            ext_list = realloc(ext_list, sizeof(char*) * (ext_count + 1));
-            ext_list[ext_count++] = strdup(token);
-            token = strtok(NULL, ",");
-        }
-        free(exts);
-        if (ext_count == 0) all_ext = 1;
-    }
+    int ext_count, all_ext;
+    char **ext_list = parse_extensions(extensions_str, &ext_count, &all_ext);
     // Ensure base output exists
     mkdir(dst, 0755);
-    // Recursive scan and arrange
+    pool_limit(current_cfg ? current_cfg->workers : 1);
+    // Recursive scan and arrange; files it no longer meets leave the state
+    state_begin_scan();
     scan_dir(src, src, dst,
              exclude_paths, exclude_count,
              ext_list, ext_count,
              all_ext, mode);
+    pool_wait();
+    state_end_scan();
+    // Entries of this scan go to the log in one append
+    log_flush(current_cfg);
     // Clean up ext_list
     for (int i = 0; i < ext_count; i++) free(ext_list[i]);
     free(ext_list);
 }
+
+/**
+ * Arrange only the given paths: regular files are arranged one by one,
+ * directories are scanned recursively
+ */
+void arrange_paths(char **paths,
+                   int path_count,
+                   const char *dst,
+                   char **exclude_paths,
+                   int exclude_count,
+                   const char *extensions_str,
+                   int mode) {
+    int ext_count, all_ext;
+    char **ext_list = parse_extensions(extensions_str, &ext_count, &all_ext);
+    mkdir(dst, 0755);
+    pool_limit(current_cfg ? current_cfg->workers : 1);
+    for (int i = 0; i < path_count; i++) {
+        const char *name = strrchr(paths[i], '/');
+        name = name ? name + 1 : paths[i];
+        struct stat st;
+        if (is_daemon_file(name) || lstat(paths[i], &st) < 0) continue;
+        if (is_excluded(paths[i], exclude_paths, exclude_count)) continue;
+        if (S_ISDIR(st.st_mode)) {
+            scan_dir(paths[i], paths[i], dst,
+                     exclude_paths, exclude_count,
+                     ext_list, ext_count, all_ext, mode);
+        } else if (S_ISREG(st.st_mode)) {
+            arrange_file(paths[i], name, &st, dst,
+                         ext_list, ext_count, all_ext, mode);
+        }
+    }
+    pool_wait();
+    log_flush(current_cfg);
+    for (int i = 0; i < ext_count; i++) free(ext_list[i]);
+    free(ext_list);
+}
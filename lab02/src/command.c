@@ -75,7 +75,10 @@ void command_help() {
     printf("    -l <MAX_LOG_LINES> : Set the maximum number of log lines\n");
     printf("    -x <EXCLUDE_PATH1,EXCLUDE_PATH2,...> : Exclude directories\n");
     printf("    -e <EXTENSION1,EXTENSION2,...> : Specify file extensions for organization\n");
-    printf("    -m <M> : Specify the duplicate file handling mode (1~3)\n\n");
+    printf("    -m <M> : Specify the duplicate file handling mode (1~3)\n");
+    printf("    -w <interval|inotify> : Rescan every <TIME_INTERVAL> seconds, or arrange changed files as inotify reports them\n");
+    printf("    -p <WORKERS> : Copy files with <WORKERS> threads in parallel (1~%d)\n", POOL_MAX_WORKERS);
+    printf("    -a <copy|reflink|link|move> : Copy, clone, hard link or move files (copy across filesystems)\n\n");
     printf("  > modify <DIR_PATH> [OPTION]...\n");
     printf("    <none> : modify daemon process config\n\n");
     printf("  > remove <DIR_PATH>\n");
@@ -134,6 +137,9 @@ int command_add(const char *args) {
     long interval = 10;               // time_interval
     size_t max_logs = 10;              // max_log_lines
     int mode = 1;                     // mode
+    int watch_mode = WATCH_INTERVAL;  // watch_mode
+    int workers = 1;                  // copy worker threads
+    int method = ARRANGE_COPY;        // arrange_method
     // exclude paths: collect multiple
     char **excl_list = NULL;
     int excl_count = 0;
@@ -218,6 +224,36 @@ int command_add(const char *args) {
             if (!arg) { fprintf(stderr, "Option -e requires extensions\n"); free(buf); return -1; }
             extensions = strdup(arg);
         }
+        else if (opt == 'w') {
+            char *arg = strtok(NULL, " \t");
+            if (!arg || (watch_mode = parse_watch_mode(arg)) < 0) {
+                fprintf(stderr, "Option -w requires interval or inotify\n");
+                free(buf);
+                return -1;
+            }
+        }
+        else if (opt == 'a') {
+            char *arg = strtok(NULL, " \t");
+            if (!arg || (method = parse_arrange_method(arg)) < 0) {
+                fprintf(stderr, "Option -a requires copy, reflink, link or move\n");
+                free(buf);
+                return -1;
+            }
+        }
+        else if (opt == 'p') {
+            char *arg = strtok(NULL, " \t");
+            if (!arg || !isdigit(arg[0])) {
+                fprintf(stderr, "Option -p requires a natural number\n");
+                free(buf);
+                return -1;
+            }
+            workers = atoi(arg);
+            if (workers < 1 || workers > POOL_MAX_WORKERS) {
+                fprintf(stderr, "Workers must be 1-%d\n", POOL_MAX_WORKERS);
+                free(buf);
+                return -1;
+            }
+        }
         else {
             fprintf(stderr, "Unknown option -%c\n", opt);
             free(buf); return -1;
@@ -305,7 +341,10 @@ if (output_raw[0]) {
                               excl_list,
                               excl_count,
                               extensions,
-                              mode) < 0) {
+                              mode,
+                              watch_mode,
+                              workers,
+                              method) < 0) {
             fprintf(stderr, "Failed to write config\n");
             return -1;
         }
@@ -382,20 +421,13 @@ int command_show(void) {
         }
         printf("extension : %s\n", *d->cfg.extensions ? d->cfg.extensions : "all");
         printf("mode : %d\n", d->cfg.mode);
+        printf("watch_mode : %s\n", watch_mode_name(d->cfg.watch_mode));
+        printf("workers : %d\n", d->cfg.workers);
+        printf("arrange_method : %s\n", arrange_method_name(d->cfg.method));
         // Log detail
         printf("\n2. log detail\n\n");
-        char log_path[MAX_PATH];
-        snprintf(log_path, sizeof(log_path), "%s/ssu_cleanupd.log", d->monitoring_path);
-        FILE *lf = fopen(log_path, "r");
-        if (lf) {
-            char line[MAX_PATH * 2];
-            while (fgets(line, sizeof(line), lf)) {
-                printf("%s", line);
-            }
-            fclose(lf);
-        } else {
+        if (log_print(d->monitoring_path, d->cfg.max_log_lines) < 0)
             printf("\n");
-        }
         return 0;
     }
 }
@@ -455,6 +487,9 @@ int command_modify(const char *args) {
     long interval       = d->cfg.time_interval;
     size_t max_logs     = d->cfg.max_log_lines;
     int mode            = d->cfg.mode;
+    int watch_mode      = d->cfg.watch_mode;
+    int workers         = d->cfg.workers;
+    int method          = d->cfg.method;
     char **excl_list    = d->cfg.exclude_paths;
     int excl_count      = d->cfg.exclude_count;
     char *extensions    = strdup(d->cfg.extensions);
@@ -509,6 +544,28 @@ int command_modify(const char *args) {
                 }
                 mode = atoi(arg);
                 break;
+            case 'w':
+                if (!arg || (watch_mode = parse_watch_mode(arg)) < 0) {
+                    fprintf(stderr,"-w requires interval or inotify\n");
+                    free(buf);
+                    return -1;
+                }
+                break;
+            case 'a':
+                if (!arg || (method = parse_arrange_method(arg)) < 0) {
+                    fprintf(stderr,"-a requires copy, reflink, link or move\n");
+                    free(buf);
+                    return -1;
+                }
+                break;
+            case 'p':
+                if (!arg || !isdigit(arg[0]) || atoi(arg) < 1 || atoi(arg) > POOL_MAX_WORKERS) {
+                    fprintf(stderr,"-p requires 1-%d\n", POOL_MAX_WORKERS);
+                    free(buf);
+                    return -1;
+                }
+                workers = atoi(arg);
+                break;
             default:
                 fprintf(stderr, "Unknown option -%c\n", opt);
                 free(buf);
@@ -525,7 +582,10 @@ int command_modify(const char *args) {
                           excl_list,
                           excl_count,
                           extensions,
-                          mode) < 0) {
+                          mode,
+                          watch_mode,
+                          workers,
+                          method) < 0) {
         fprintf(stderr, "Failed to write config\n");
         free(buf);
         return -1;
@@ -569,7 +629,7 @@ int command_remove(const char *args) {
         return -1;
     }
     
-    if (daemon_remove(target_pid) == 0) {
+    if (daemon_remove(real_src) == 0) {
         printf("Daemon watching %s removed (PID %d)\n", real_src, target_pid);
         return 0;
     } else {
@@ -589,7 +649,10 @@ int write_config_file(const char *path,
                       char **exclude_paths,
                       int exclude_count,
                       const char *extensions,
-                      int mode)
+                      int mode,
+                      int watch_mode,
+                      int workers,
+                      int method)
 {
     FILE *fp = fopen(path, "w");
     if (!fp) return -1;
@@ -615,6 +678,9 @@ int write_config_file(const char *path,
     }
     fprintf(fp, "extension       : %s\n", extensions && *extensions ? extensions : "all");
     fprintf(fp, "mode            : %d\n", mode);
+    fprintf(fp, "watch_mode      : %s\n", watch_mode_name(watch_mode));
+    fprintf(fp, "workers         : %d\n", workers);
+    fprintf(fp, "arrange_method  : %s\n", arrange_method_name(method));
     fclose(fp);
     return 0;
 }
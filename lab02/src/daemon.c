@@ -14,18 +14,121 @@
 #include <ctype.h>
 #include "header.h"  // daemon_t, daemon_config_t, prototypes for arrange_directory, daemon_list_all, etc.
 
-#define MAX_DAEMONS 128
-static daemon_t *daemon_list[MAX_DAEMONS];
+#define MAX_DAEMONS 128   // forked daemons; the supervisor has no limit
+static daemon_t **daemon_list = NULL;
 static int daemon_count = 0;
+static int daemon_cap = 0;
+static int supervised = 0;   // directories are handed to the supervisor process
 daemon_config_t *current_cfg = NULL;
 bool current_first_run = true;
+volatile sig_atomic_t reload_requested = 0;
 
 // Forward declarations
 static void daemonize_process(void);
 static void monitor_loop(daemon_t *d);
+static void on_sighup(int sig);
 static int is_subpath(const char *parent, const char *child);
 static char *trim(char *s);
 static int count_ext(const char *extensions_str);
+static int list_append(daemon_t *d);
+static daemon_t *new_entry(pid_t pid, const char *monitor_path, const char *output_path, const char *config_file);
+static pid_t supervisor_start(void);
+static int supervisor_notify(void);
+
+// Helper: grow the daemon list as needed
+static int list_append(daemon_t *d) {
+    if (daemon_count == daemon_cap) {
+        int cap = daemon_cap ? daemon_cap * 2 : 16;
+        daemon_t **list = realloc(daemon_list, sizeof(daemon_t*) * cap);
+        if (!list) return -1;
+        daemon_list = list;
+        daemon_cap = cap;
+    }
+    daemon_list[daemon_count++] = d;
+    return 0;
+}
+
+// Helper: daemon metadata kept by the prompt
+static daemon_t *new_entry(pid_t pid, const char *monitor_path, const char *output_path, const char *config_file) {
+    daemon_t *d = malloc(sizeof(*d));
+    if (!d) return NULL;
+    memset(d, 0, sizeof(*d));
+    d->pid = pid;
+    d->monitoring_path = strdup(monitor_path);
+    d->output_path     = strdup(output_path);
+    d->config_file     = strdup(config_file);
+    return d;
+}
+
+// Helper: start the supervisor daemon; its PID, or -1
+static pid_t supervisor_start(void) {
+    int fds[2];
+    if (pipe(fds) < 0) return -1;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        daemonize_process();
+        supervisor_main(fds[1]);
+        exit(0);
+    }
+    // the daemon reports its own PID once the registry is loaded
+    close(fds[1]);
+    pid_t spid = -1;
+    if (read(fds[0], &spid, sizeof(spid)) != sizeof(spid)) spid = -1;
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    return spid;
+}
+
+// Helper: write the registry and tell the supervisor, starting it if needed
+static int supervisor_notify(void) {
+    char **paths = daemon_list_all_paths(NULL);
+    int ret = registry_write(paths, daemon_count);
+    free(paths);
+    if (ret < 0) return -1;
+    pid_t pid = supervisor_pid();
+    if (pid > 0) {
+        if (daemon_count == 0) kill(pid, SIGTERM);
+        else kill(pid, SIGHUP);
+    } else if (daemon_count > 0) {
+        pid = supervisor_start();
+        if (pid < 0) return -1;
+    }
+    for (int i = 0; i < daemon_count; i++) daemon_list[i]->pid = pid;
+    return 0;
+}
+
+/**
+ * Hand every directory to one supervisor daemon instead of forking one
+ * daemon each; picks up the directories it already monitors
+ */
+int daemon_use_supervisor(void) {
+    supervised = 1;
+    int count = 0;
+    char **paths = registry_read(&count);
+    for (int i = 0; i < count; i++) {
+        char conf[PATH_MAX];
+        snprintf(conf, sizeof(conf), "%s/ssu_cleanupd.config", paths[i]);
+        daemon_config_t cfg;
+        memset(&cfg, 0, sizeof(cfg));
+        parse_config(conf, &cfg);
+        daemon_t *d = new_entry(0, paths[i], cfg.output_path ? cfg.output_path : "", conf);
+        if (d) {
+            d->cfg = cfg;
+            list_append(d);
+        }
+        free(paths[i]);
+    }
+    free(paths);
+    // resume monitoring if the supervisor is not running
+    if (daemon_count > 0) return supervisor_notify();
+    return 0;
+}
 
 // Add a new daemon: fork, daemonize child, and register in parent
 int daemon_add(const char *monitor_path,
@@ -38,20 +141,15 @@ int daemon_add(const char *monitor_path,
                const char *extensions,
                int mode)
 {
-    if (daemon_count >= MAX_DAEMONS) return -1;
-    pid_t pid = fork();
+    if (!supervised && daemon_count >= MAX_DAEMONS) return -1;
+    pid_t pid = supervised ? 0 : fork();
     if (pid < 0) {
         return -1;
     }
-    if (pid > 0) {
+    if (supervised || pid > 0) {
         // Parent: register daemon metadata
-        daemon_t *d = malloc(sizeof(*d));
+        daemon_t *d = new_entry(pid, monitor_path, output_path, config_file);
         if (!d) return -1;
-        memset(d, 0, sizeof(*d));
-        d->pid = pid;
-        d->monitoring_path = strdup(monitor_path);
-        d->output_path     = strdup(output_path);
-        d->config_file     = strdup(config_file);
         // Initialize config
         d->cfg.time_interval = interval;
         d->cfg.max_log_lines = max_logs;
@@ -60,8 +158,8 @@ int daemon_add(const char *monitor_path,
         d->cfg.extensions    = strdup(extensions ? extensions : "");
         d->cfg.ext_count     = count_ext(extensions);
         d->cfg.mode          = mode;
-        daemon_list[daemon_count++] = d;
-        return 0;
+        if (list_append(d) < 0) return -1;
+        return supervised ? supervisor_notify() : 0;
     }
     // Child: become daemon
     daemonize_process();
@@ -79,12 +177,16 @@ int daemon_add(const char *monitor_path,
     exit(0);
 }
 
-// Remove daemon by PID: send SIGTERM and unregister
-int daemon_remove(pid_t pid) {
+// Remove the daemon monitoring a path: SIGTERM (or drop it from the
+// supervisor) and unregister
+int daemon_remove(const char *monitoring_path) {
     for (int i = 0; i < daemon_count; i++) {
-        if (daemon_list[i]->pid == pid) {
-            kill(pid, SIGTERM);
-            waitpid(pid, NULL, 0);
+        if (strcmp(daemon_list[i]->monitoring_path, monitoring_path) == 0) {
+            pid_t pid = daemon_list[i]->pid;
+            if (!supervised) {
+                kill(pid, SIGTERM);
+                waitpid(pid, NULL, 0);
+            }
             // Free and shift list
             free(daemon_list[i]->monitoring_path);
             free(daemon_list[i]->output_path);
@@ -94,7 +196,7 @@ int daemon_remove(pid_t pid) {
             for (int j = i; j < daemon_count - 1; j++)
                 daemon_list[j] = daemon_list[j+1];
             daemon_count--;
-            return 0;
+            return supervised ? supervisor_notify() : 0;
         }
     }
     return -1;
@@ -136,10 +238,25 @@ int daemon_is_monitored(const char *path) {
     return 0;
 }
 
-// Core monitoring loop: parse config, arrange, log, and sleep
+// SIGHUP: re-read the config file (interrupts the sleep or the event wait)
+static void on_sighup(int sig) {
+    (void)sig;
+    reload_requested = 1;
+}
+
+// Core monitoring loop: parse config, arrange, log, and sleep;
+// in inotify mode the event loop takes over until the mode is changed back
 static void monitor_loop(daemon_t *d) {
     struct timespec interval;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sighup;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGHUP, &sa, NULL);
+    // files arranged by earlier runs of this daemon are not looked at again
+    state_open(d->monitoring_path);
     while (1) {
+        reload_requested = 0;
         parse_config(d->config_file, &d->cfg);
         d->cfg.pid = d->pid;
         d->cfg.monitoring_path = d->monitoring_path;
@@ -147,12 +264,15 @@ static void monitor_loop(daemon_t *d) {
         interval.tv_sec  = d->cfg.time_interval;
         interval.tv_nsec = 0;
         current_cfg = &d->cfg;
+        // falls back to interval scans when inotify cannot be set up
+        if (d->cfg.watch_mode == WATCH_INOTIFY && watch_loop(d) == 0) continue;
         arrange_directory(d->monitoring_path,
                           d->output_path,
                           d->cfg.exclude_paths,
                           d->cfg.exclude_count,
                           d->cfg.extensions,
                           d->cfg.mode);
+        state_save();
         current_first_run = false;
         nanosleep(&interval, NULL);
     }
@@ -208,6 +328,37 @@ static int count_ext(const char *extensions_str) {
     return count;
 }
 
+// Config file name of a watch mode
+const char *watch_mode_name(int watch_mode) {
+    return watch_mode == WATCH_INOTIFY ? "inotify" : "interval";
+}
+
+// Watch mode from its config file name, -1 if unknown
+int parse_watch_mode(const char *name) {
+    if (strcmp(name, "interval") == 0) return WATCH_INTERVAL;
+    if (strcmp(name, "inotify") == 0) return WATCH_INOTIFY;
+    return -1;
+}
+
+// Config file name of an arrange method
+const char *arrange_method_name(int method) {
+    switch (method) {
+        case ARRANGE_REFLINK: return "reflink";
+        case ARRANGE_LINK:    return "link";
+        case ARRANGE_MOVE:    return "move";
+        default:              return "copy";
+    }
+}
+
+// Arrange method from its config file name, -1 if unknown
+int parse_arrange_method(const char *name) {
+    if (strcmp(name, "copy") == 0) return ARRANGE_COPY;
+    if (strcmp(name, "reflink") == 0) return ARRANGE_REFLINK;
+    if (strcmp(name, "link") == 0) return ARRANGE_LINK;
+    if (strcmp(name, "move") == 0) return ARRANGE_MOVE;
+    return -1;
+}
+
 // Parse config file into daemon_config_t
 int parse_config(const char *config_file, daemon_config_t *cfg) {
     FILE *fp = fopen(config_file, "r");
@@ -221,6 +372,9 @@ int parse_config(const char *config_file, daemon_config_t *cfg) {
     cfg->extensions = strdup("");
     cfg->ext_count = 0;
     cfg->mode = 1;
+    cfg->watch_mode = WATCH_INTERVAL;
+    cfg->workers = 1;
+    cfg->method = ARRANGE_COPY;
     char line[1024];
     while (fgets(line, sizeof(line), fp)) {
         char *p = strchr(line, ':');
@@ -260,54 +414,18 @@ int parse_config(const char *config_file, daemon_config_t *cfg) {
             }
         } else if (strcmp(key, "mode") == 0) {
             cfg->mode = atoi(val);
+        } else if (strcmp(key, "watch_mode") == 0) {
+            int wm = parse_watch_mode(val);
+            if (wm >= 0) cfg->watch_mode = wm;
+        } else if (strcmp(key, "workers") == 0) {
+            int n = atoi(val);
+            if (n >= 1 && n <= POOL_MAX_WORKERS) cfg->workers = n;
+        } else if (strcmp(key, "arrange_method") == 0) {
+            int am = parse_arrange_method(val);
+            if (am >= 0) cfg->method = am;
         }
     }
     fclose(fp);
     return 0;
 }
 
-// Log an event and enforce max_log_lines
-int log_event(const daemon_config_t *cfg,
-              const char *src_path,
-              const char *dst_path)
-{
-    // timestamp
-    time_t now = time(NULL);
-    struct tm lt;
-    localtime_r(&now, &lt);
-    char tbuf[9];
-    snprintf(tbuf,sizeof(tbuf),"%02d:%02d:%02d",lt.tm_hour,lt.tm_min,lt.tm_sec);
-    
-    // new entry
-    char entry[PATH_MAX*2];
-    snprintf(entry, sizeof(entry), "[%s] [%d] [%s] [%s]\n",
-             tbuf, (int)cfg->pid, src_path, dst_path);
-    // read existing
-    char log_path[PATH_MAX];
-    snprintf(log_path, sizeof(log_path), "%s/ssu_cleanupd.log", cfg->monitoring_path);
-    FILE *fp = fopen(log_path, "r");
-    char **lines = NULL; size_t count = 0;
-    if (fp) {
-        char buf[PATH_MAX*2];
-        while (fgets(buf, sizeof(buf), fp)) {
-            lines = realloc(lines, sizeof(char*)*(count+1));
-            lines[count++] = strdup(buf);
-        }
-        fclose(fp);
-    }
-    lines = realloc(lines, sizeof(char*)*(count+1));
-    lines[count++] = strdup(entry);
-    // enforce max
-    if (cfg->max_log_lines > 0 && count > cfg->max_log_lines) {
-        size_t to_remove = count - cfg->max_log_lines;
-        for (size_t i = 0; i < to_remove; i++) free(lines[i]);
-        memmove(lines, lines + to_remove, sizeof(char*) * (count - to_remove));
-        count = cfg->max_log_lines;
-    }
-    fp = fopen(log_path, "w");
-    if (!fp) { for (size_t i=0;i<count;i++) free(lines[i]); free(lines); return -1; }
-    for (size_t i=0;i<count;i++) { fputs(lines[i], fp); free(lines[i]); }
-    free(lines);
-    fclose(fp);
-    return 0;
-}
@@ -9,11 +9,26 @@
 #include <sys/wait.h>
 #include <errno.h>
 #include <libgen.h>
+#include <signal.h>
+#include <sys/stat.h>
 
 // Maximum path length
 #define MAX_PATH 4096
 #define MAX_COMMAND 1000
 
+// How a daemon notices changes
+#define WATCH_INTERVAL 0   // full rescan every time_interval seconds
+#define WATCH_INOTIFY  1   // inotify events, arranging only changed files
+
+// How a file reaches the output directory
+#define ARRANGE_COPY    0   // read/write copy
+#define ARRANGE_REFLINK 1   // ioctl(FICLONE): shares data blocks until either side changes
+#define ARRANGE_LINK    2   // hard link to the same inode
+#define ARRANGE_MOVE    3   // rename: the file leaves the monitored directory
+
+// Copy worker threads per daemon
+#define POOL_MAX_WORKERS 64
+
 // Daemon configuration structure
 typedef struct {
     char   *monitoring_path;   // Monitored directory path
@@ -27,6 +42,9 @@ typedef struct {
     char   *extensions;        // Comma-separated extensions to include
     int     ext_count;         // Number of extensions
     int     mode;              // Duplicate handling mode
+    int     watch_mode;        // WATCH_INTERVAL or WATCH_INOTIFY
+    int     workers;           // Copy worker threads (1 = copy inline)
+    int     method;            // ARRANGE_COPY, ARRANGE_REFLINK, ARRANGE_LINK or ARRANGE_MOVE
 } daemon_config_t;
 
 // Daemon metadata
@@ -47,6 +65,7 @@ void command_help(void);
 void command_loop(void);
 
 // daemon.c
+extern volatile sig_atomic_t reload_requested;
 int daemon_add(const char *monitor_path,
                const char *output_path,
                const char *config_file,
@@ -56,15 +75,13 @@ int daemon_add(const char *monitor_path,
                int exclude_count,
                const char *extensions,
                int mode);
-int daemon_remove(pid_t pid);
+int daemon_use_supervisor(void);
+int daemon_remove(const char *monitoring_path);
 int daemon_reload(pid_t pid);
 int daemon_list_all(daemon_t ***out_list);
 char **daemon_list_all_paths(int *out_count);
 int daemon_is_monitored(const char *path);
 int parse_config(const char *config_file, daemon_config_t *cfg);
-int log_event(const daemon_config_t *cfg,
-              const char *src_path,
-              const char *dst_path);
 int write_config_file(const char *path,
                       const char *monitoring_path,
                       const char *output_path,
@@ -73,14 +90,93 @@ int write_config_file(const char *path,
                       char **exclude_paths,
                       int exclude_count,
                       const char *extensions,
-                      int mode);
+                      int mode,
+                      int watch_mode,
+                      int workers,
+                      int method);
+const char *watch_mode_name(int watch_mode);
+int parse_watch_mode(const char *name);
+const char *arrange_method_name(int method);
+int parse_arrange_method(const char *name);
+
+// log.c
+int log_event(const daemon_config_t *cfg,
+              const char *src_path,
+              const char *dst_path);
+int log_flush(const daemon_config_t *cfg);
+int log_print(const char *monitoring_path, size_t max_log_lines);
+
+// state.c
+typedef struct state state_t;
+state_t *state_open(const char *monitoring_path);
+void state_use(state_t *st);
+void state_close(state_t *st);
+void state_begin_scan(void);
+void state_end_scan(void);
+int state_unchanged(const struct stat *st, const char *dst);
+void state_record(const struct stat *st, const char *dst);
+int state_save(void);
+
+// watch.c
+typedef struct watcher watcher_t;
+
+// Changes noticed in one monitored tree
+typedef struct {
+    daemon_t   *d;              // daemon monitoring the tree
+    char      **queue;          // changed paths waiting to be arranged
+    int         queue_count;
+    int         queue_cap;
+    int         rescan;         // events were lost: scan the whole tree
+    int         reload;         // the config file was rewritten
+    int         gone;           // the monitored directory itself disappeared
+    long long   first_ms;       // first / last event of the pending burst (0 = none)
+    long long   last_ms;
+} watch_set_t;
+
+long long monotonic_ms(void);
+watcher_t *watcher_new(void);
+int watcher_fd(const watcher_t *w);
+void watcher_free(watcher_t *w);
+watch_set_t *watch_add(watcher_t *w, daemon_t *d);
+void watch_remove(watcher_t *w, watch_set_t *s);
+void watch_read(watcher_t *w);
+long long watch_due(const watch_set_t *s, long long now_ms);
+void watch_arrange(watch_set_t *s);
+int watch_loop(daemon_t *d);
+
+// supervisor.c
+char **registry_read(int *out_count);
+int registry_write(char **paths, int count);
+pid_t supervisor_pid(void);
+void supervisor_main(int ready_fd);
+
+// pool.c
+void pool_limit(int workers);
+void pool_submit(const char *src_path,
+                 const char *dest_dir,
+                 const char *dest_path,
+                 const struct stat *st,
+                 int mode);
+void pool_wait(void);
 
 // arrange.c
+void arrange_copy(const char *src_path,
+                  const char *dest_dir,
+                  const char *dest_path,
+                  const struct stat *st,
+                  int mode);
 void arrange_directory(const char *src,
                        const char *dst,
                        char **exclude_paths,
                        int exclude_count,
                        const char *extensions,
                        int mode);
+void arrange_paths(char **paths,
+                   int path_count,
+                   const char *dst,
+                   char **exclude_paths,
+                   int exclude_count,
+                   const char *extensions,
+                   int mode);
 
 #endif // HEADER_H
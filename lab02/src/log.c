@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "header.h"  // daemon_config_t, prototypes for log_event, log_flush, log_print
+
+#define LOG_MAGIC   "SSUL"
+#define LOG_VERSION 1
+
+// Header shared by every process touching the log (mapped from ssu_cleanupd.log.idx).
+// The newest lines are in ssu_cleanupd.log; once it holds max_log_lines lines it is
+// renamed to ssu_cleanupd.log.old, so the last max_log_lines lines always live in
+// the tail of .old followed by the whole current segment.
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint64_t old_lines;   // lines in ssu_cleanupd.log.old
+    uint64_t cur_lines;   // lines in ssu_cleanupd.log
+} log_header_t;
+
+// Entries of the current scan, written by log_flush()
+static const daemon_config_t *pending_cfg = NULL;
+static char  *pending = NULL;
+static size_t pending_len = 0;
+static size_t pending_cap = 0;
+static pthread_mutex_t pending_lock = PTHREAD_MUTEX_INITIALIZER;   // copy workers log concurrently
+
+// Forward declarations
+static void log_paths(const char *monitoring_path, char *log_path, char *old_path, char *idx_path);
+static int lock_file(int fd, short type);
+static uint64_t count_lines(const char *path);
+static int write_all(int fd, const char *buf, size_t len);
+static int print_lines(const char *path, uint64_t skip);
+
+// Helper: paths of the current segment, the previous segment and the header
+static void log_paths(const char *monitoring_path, char *log_path, char *old_path, char *idx_path) {
+    snprintf(log_path, PATH_MAX, "%s/ssu_cleanupd.log", monitoring_path);
+    snprintf(old_path, PATH_MAX, "%s/ssu_cleanupd.log.old", monitoring_path);
+    snprintf(idx_path, PATH_MAX, "%s/ssu_cleanupd.log.idx", monitoring_path);
+}
+
+// Helper: fcntl lock (F_RDLCK, F_WRLCK or F_UNLCK) on the whole file
+static int lock_file(int fd, short type) {
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &fl) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return 0;
+}
+
+// Helper: number of lines in a file (0 if missing); only used to adopt a log without header
+static uint64_t count_lines(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    uint64_t n = 0;
+    int c;
+    while ((c = getc(fp)) != EOF) {
+        if (c == '\n') n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Helper: print a file to stdout, leaving out its first 'skip' lines
+static int print_lines(const char *path, uint64_t skip) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    char *line = NULL;
+    size_t cap = 0;
+    while (getline(&line, &cap, fp) > 0) {
+        if (skip > 0) { skip--; continue; }
+        fputs(line, stdout);
+    }
+    free(line);
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * Queue a log entry; it reaches the log file with the next log_flush()
+ */
+int log_event(const daemon_config_t *cfg,
+              const char *src_path,
+              const char *dst_path)
+{
+    // timestamp
+    time_t now = time(NULL);
+    struct tm lt;
+    localtime_r(&now, &lt);
+    char tbuf[9];
+    snprintf(tbuf,sizeof(tbuf),"%02d:%02d:%02d",lt.tm_hour,lt.tm_min,lt.tm_sec);
+
+    // new entry
+    char entry[PATH_MAX*2];
+    int len = snprintf(entry, sizeof(entry), "[%s] [%d] [%s] [%s]\n",
+                       tbuf, (int)cfg->pid, src_path, dst_path);
+    if (len < 0) return -1;
+    if ((size_t)len >= sizeof(entry)) {
+        len = sizeof(entry) - 1;
+        entry[len - 1] = '\n';
+    }
+    pthread_mutex_lock(&pending_lock);
+    // entries of another daemon's scan go out first
+    while (pending_cfg && pending_cfg != cfg) {
+        const daemon_config_t *prev = pending_cfg;
+        pthread_mutex_unlock(&pending_lock);
+        log_flush(prev);
+        pthread_mutex_lock(&pending_lock);
+    }
+    pending_cfg = cfg;
+    if (pending_len + len > pending_cap) {
+        size_t cap = pending_cap ? pending_cap * 2 : 16384;
+        while (cap < pending_len + len) cap *= 2;
+        char *p = realloc(pending, cap);
+        if (!p) {
+            pthread_mutex_unlock(&pending_lock);
+            return -1;
+        }
+        pending = p;
+        pending_cap = cap;
+    }
+    memcpy(pending + pending_len, entry, len);
+    pending_len += len;
+    pthread_mutex_unlock(&pending_lock);
+    return 0;
+}
+
+/**
+ * Append the queued entries under one fcntl lock, rotating the segment
+ * whenever it reaches max_log_lines (a rename, never a rewrite)
+ */
+int log_flush(const daemon_config_t *cfg) {
+    pthread_mutex_lock(&pending_lock);
+    if (pending_len == 0 || pending_cfg != cfg) {
+        pthread_mutex_unlock(&pending_lock);
+        return 0;
+    }
+    char log_path[PATH_MAX], old_path[PATH_MAX], idx_path[PATH_MAX];
+    log_paths(cfg->monitoring_path, log_path, old_path, idx_path);
+
+    int ret = -1;
+    int log_fd = -1;
+    log_header_t *hdr = MAP_FAILED;
+    int idx_fd = open(idx_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (idx_fd < 0) goto out;
+    if (lock_file(idx_fd, F_WRLCK) < 0) goto out;
+    struct stat st;
+    if (fstat(idx_fd, &st) < 0) goto out;
+    if (st.st_size < (off_t)sizeof(log_header_t) && ftruncate(idx_fd, sizeof(log_header_t)) < 0)
+        goto out;
+    hdr = mmap(NULL, sizeof(log_header_t), PROT_READ | PROT_WRITE, MAP_SHARED, idx_fd, 0);
+    if (hdr == MAP_FAILED) goto out;
+    if (memcmp(hdr->magic, LOG_MAGIC, 4) != 0 || hdr->version != LOG_VERSION) {
+        // first flush, or a log from before the header existed
+        hdr->old_lines = count_lines(old_path);
+        hdr->cur_lines = count_lines(log_path);
+        hdr->version = LOG_VERSION;
+        memcpy(hdr->magic, LOG_MAGIC, 4);
+    }
+
+    size_t max = cfg->max_log_lines;
+    const char *p = pending;
+    const char *end = pending + pending_len;
+    while (p < end) {
+        if (max > 0 && hdr->cur_lines >= max) {
+            // segment full: it becomes the previous one
+            if (log_fd >= 0) { close(log_fd); log_fd = -1; }
+            if (rename(log_path, old_path) < 0 && errno != ENOENT) goto out;
+            hdr->old_lines = hdr->cur_lines;
+            hdr->cur_lines = 0;
+        }
+        // as many whole lines as the segment still takes
+        const char *q = p;
+        uint64_t n = 0;
+        while (q < end && (max == 0 || hdr->cur_lines + n < max)) {
+            const char *nl = memchr(q, '\n', end - q);
+            q = nl ? nl + 1 : end;
+            n++;
+        }
+        if (log_fd < 0) {
+            log_fd = open(log_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+            if (log_fd < 0) goto out;
+        }
+        if (write_all(log_fd, p, q - p) < 0) goto out;
+        hdr->cur_lines += n;
+        p = q;
+    }
+    ret = 0;
+
+out:
+    if (log_fd >= 0) close(log_fd);
+    if (hdr != MAP_FAILED) munmap(hdr, sizeof(log_header_t));
+    if (idx_fd >= 0) close(idx_fd);   // also drops the lock
+    pending_len = 0;
+    pending_cfg = NULL;
+    pthread_mutex_unlock(&pending_lock);
+    return ret;
+}
+
+/**
+ * Print the last max_log_lines lines of a daemon's log (all when 0)
+ */
+int log_print(const char *monitoring_path, size_t max_log_lines) {
+    char log_path[PATH_MAX], old_path[PATH_MAX], idx_path[PATH_MAX];
+    log_paths(monitoring_path, log_path, old_path, idx_path);
+
+    log_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    int idx_fd = open(idx_path, O_RDONLY | O_CLOEXEC);
+    if (idx_fd >= 0) {
+        // shared lock: no rotation while both segments are read
+        lock_file(idx_fd, F_RDLCK);
+        if (pread(idx_fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) memset(&hdr, 0, sizeof(hdr));
+    }
+    if (memcmp(hdr.magic, LOG_MAGIC, 4) != 0) {
+        hdr.old_lines = count_lines(old_path);
+        hdr.cur_lines = count_lines(log_path);
+    }
+    uint64_t total = hdr.old_lines + hdr.cur_lines;
+    uint64_t skip = max_log_lines > 0 && total > max_log_lines ? total - max_log_lines : 0;
+    int ret = -1;
+    if (skip < hdr.old_lines) {
+        if (print_lines(old_path, skip) == 0) ret = 0;
+        skip = 0;
+    } else {
+        skip -= hdr.old_lines;
+    }
+    if (print_lines(log_path, skip) == 0) ret = 0;
+    if (idx_fd >= 0) close(idx_fd);
+    return ret;
+}
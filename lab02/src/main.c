@@ -1,9 +1,19 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "header.h"
 
-int main(void)
+int main(int argc, char *argv[])
 {
+    // -s : one supervisor daemon monitors every directory
+    if (argc == 2 && strcmp(argv[1], "-s") == 0) {
+        if (daemon_use_supervisor() < 0)
+            fprintf(stderr, "Failed to start the supervisor\n");
+    } else if (argc != 1) {
+        fprintf(stderr, "Usage: %s [-s]\n", argv[0]);
+        return 1;
+    }
+
     // start prompt
     command_loop();
 
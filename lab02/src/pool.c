@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include "header.h"  // prototypes for pool_limit, pool_submit, pool_wait, arrange_copy
+
+#define POOL_QUEUE 256   // jobs waiting at most; the scan blocks beyond that
+
+// One file to copy into the output directory
+typedef struct {
+    char        *src_path;
+    char        *dest_dir;
+    char        *dest_path;
+    struct stat  st;
+    int          mode;
+} copy_job_t;
+
+static int thread_count = 0;           // started workers; the pool never shrinks
+static int pool_size = 0;              // largest size asked for (a failed start is not retried)
+static int limit = 0;                  // jobs of the current scan copied at once; 0: inline
+static copy_job_t queue[POOL_QUEUE];   // ring buffer
+static int queue_head = 0;
+static int queue_count = 0;
+static int busy = 0;                   // jobs taken by a worker and not finished
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t idle = PTHREAD_COND_INITIALIZER;
+
+// Forward declarations
+static void run_job(copy_job_t *job);
+static void *worker_main(void *arg);
+
+// Helper: copy one file and free the job's strings
+static void run_job(copy_job_t *job) {
+    arrange_copy(job->src_path, job->dest_dir, job->dest_path, &job->st, job->mode);
+    free(job->src_path);
+    free(job->dest_dir);
+    free(job->dest_path);
+}
+
+// Copy worker: take jobs while the current scan's limit allows
+static void *worker_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&pool_lock);
+    while (1) {
+        while (queue_count == 0 || busy >= limit)
+            pthread_cond_wait(&not_empty, &pool_lock);
+        copy_job_t job = queue[queue_head];
+        queue_head = (queue_head + 1) % POOL_QUEUE;
+        queue_count--;
+        busy++;
+        pthread_cond_signal(&not_full);
+        pthread_mutex_unlock(&pool_lock);
+
+        run_job(&job);
+
+        pthread_mutex_lock(&pool_lock);
+        busy--;
+        if (queue_count > 0) pthread_cond_signal(&not_empty);
+        else if (busy == 0) pthread_cond_broadcast(&idle);
+    }
+    return NULL;
+}
+
+/**
+ * Copy the next scan's files with up to 'workers' threads (1 or less:
+ * inline, as before). The pool grows to the largest value asked for and
+ * is shared by every directory; 'workers' only caps how many of its
+ * threads work on this scan. Call between scans (after pool_wait()).
+ */
+void pool_limit(int workers) {
+    if (workers > POOL_MAX_WORKERS) workers = POOL_MAX_WORKERS;
+    if (workers <= 1) workers = 0;
+    if (workers > pool_size) {
+        // signals (SIGHUP, SIGTERM) stay with the main thread
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &old);
+        for (int i = thread_count; i < workers; i++) {
+            pthread_t tid;
+            if (pthread_create(&tid, NULL, worker_main, NULL) != 0) break;
+            pthread_detach(tid);
+            thread_count++;
+        }
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        pool_size = workers;
+    }
+    pthread_mutex_lock(&pool_lock);
+    limit = workers < thread_count ? workers : thread_count;
+    pthread_cond_broadcast(&not_empty);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/**
+ * Hand a file to the copy workers; blocks while POOL_QUEUE jobs are waiting
+ */
+void pool_submit(const char *src_path,
+                 const char *dest_dir,
+                 const char *dest_path,
+                 const struct stat *st,
+                 int mode) {
+    if (limit == 0) {
+        arrange_copy(src_path, dest_dir, dest_path, st, mode);
+        return;
+    }
+    copy_job_t job;
+    job.src_path = strdup(src_path);
+    job.dest_dir = strdup(dest_dir);
+    job.dest_path = strdup(dest_path);
+    job.st = *st;
+    job.mode = mode;
+    if (!job.src_path || !job.dest_dir || !job.dest_path) {
+        free(job.src_path);
+        free(job.dest_dir);
+        free(job.dest_path);
+        return;
+    }
+    pthread_mutex_lock(&pool_lock);
+    while (queue_count == POOL_QUEUE)
+        pthread_cond_wait(&not_full, &pool_lock);
+    queue[(queue_head + queue_count) % POOL_QUEUE] = job;
+    queue_count++;
+    pthread_cond_signal(&not_empty);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/**
+ * Wait until every submitted file has been handled
+ */
+void pool_wait(void) {
+    pthread_mutex_lock(&pool_lock);
+    while (queue_count > 0 || busy > 0)
+        pthread_cond_wait(&idle, &pool_lock);
+    pthread_mutex_unlock(&pool_lock);
+}
@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "header.h"  // state_t, prototypes for state_open, state_unchanged, state_record
+
+#define STATE_MAGIC   "SSUS"
+#define STATE_VERSION 1
+
+// On-disk record header; the destination path (dst_len bytes) follows
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t  size;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    uint32_t dst_len;
+} state_rec_t;
+
+// In-memory entry, keyed by (dev, ino)
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;          // 0 = empty slot
+    int64_t  size;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    char    *dst;          // destination already written for this version
+    unsigned seen;         // scan generation that last met the file
+} state_entry_t;
+
+// State of one monitored directory
+struct state {
+    state_entry_t *table;   // open addressing, linear probing
+    size_t table_cap;       // power of two
+    size_t table_count;
+    unsigned scan_gen;
+    int dirty;              // changed since the last save
+    char file[PATH_MAX];
+};
+
+// State the arrange functions work on (state_open / state_use)
+static state_t *cur = NULL;
+// Copy workers record while the scan looks up
+static pthread_mutex_t state_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Forward declarations
+static size_t hash_key(uint64_t dev, uint64_t ino);
+static state_entry_t *find_slot(state_entry_t *tab, size_t cap, uint64_t dev, uint64_t ino);
+static int grow(state_t *st);
+static state_entry_t *insert(state_t *st, uint64_t dev, uint64_t ino);
+
+static size_t hash_key(uint64_t dev, uint64_t ino) {
+    uint64_t h = ino * 0x9E3779B97F4A7C15ull ^ dev * 0xC2B2AE3D27D4EB4Full;
+    return (size_t)(h ^ (h >> 29));
+}
+
+// Slot holding (dev, ino), or the empty slot where it would go
+static state_entry_t *find_slot(state_entry_t *tab, size_t cap, uint64_t dev, uint64_t ino) {
+    size_t i = hash_key(dev, ino) & (cap - 1);
+    while (tab[i].ino != 0 && (tab[i].ino != ino || tab[i].dev != dev))
+        i = (i + 1) & (cap - 1);
+    return &tab[i];
+}
+
+// Double the table (keeps it at most half full)
+static int grow(state_t *st) {
+    size_t cap = st->table_cap ? st->table_cap * 2 : 1024;
+    state_entry_t *tab = calloc(cap, sizeof(state_entry_t));
+    if (!tab) return -1;
+    for (size_t i = 0; i < st->table_cap; i++) {
+        state_entry_t *e = &st->table[i];
+        if (e->ino) *find_slot(tab, cap, e->dev, e->ino) = *e;
+    }
+    free(st->table);
+    st->table = tab;
+    st->table_cap = cap;
+    return 0;
+}
+
+static state_entry_t *insert(state_t *st, uint64_t dev, uint64_t ino) {
+    if ((st->table_count + 1) * 2 > st->table_cap && grow(st) < 0) return NULL;
+    state_entry_t *e = find_slot(st->table, st->table_cap, dev, ino);
+    if (e->ino == 0) {
+        memset(e, 0, sizeof(*e));
+        e->dev = dev;
+        e->ino = ino;
+        st->table_count++;
+    }
+    return e;
+}
+
+/**
+ * Load the state kept next to the config of the daemon monitoring 'monitoring_path';
+ * the returned state becomes the one the arrange functions use
+ */
+state_t *state_open(const char *monitoring_path) {
+    state_t *st = calloc(1, sizeof(state_t));
+    if (!st) return NULL;
+    st->scan_gen = 1;
+    snprintf(st->file, sizeof(st->file), "%s/ssu_cleanupd.state", monitoring_path);
+    cur = st;
+    FILE *fp = fopen(st->file, "rb");
+    if (!fp) return st;   // first run
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    if (fread(magic, 4, 1, fp) != 1 || memcmp(magic, STATE_MAGIC, 4) != 0 ||
+        fread(&version, sizeof(version), 1, fp) != 1 || version != STATE_VERSION ||
+        fread(&count, sizeof(count), 1, fp) != 1) {
+        fclose(fp);
+        return st;        // unreadable: start over
+    }
+    state_rec_t rec;
+    for (uint64_t i = 0; i < count && fread(&rec, sizeof(rec), 1, fp) == 1; i++) {
+        if (rec.dst_len == 0 || rec.dst_len >= PATH_MAX) break;
+        char *dst = malloc(rec.dst_len + 1);
+        if (!dst || fread(dst, rec.dst_len, 1, fp) != 1) { free(dst); break; }
+        dst[rec.dst_len] = '\0';
+        state_entry_t *e = insert(st, rec.dev, rec.ino);
+        if (!e) { free(dst); break; }
+        free(e->dst);
+        e->size = rec.size;
+        e->mtime_sec = rec.mtime_sec;
+        e->mtime_nsec = rec.mtime_nsec;
+        e->dst = dst;
+    }
+    fclose(fp);
+    return st;
+}
+
+/**
+ * Make 'st' the state the arrange functions use
+ */
+void state_use(state_t *st) {
+    cur = st;
+}
+
+/**
+ * Save and free a state
+ */
+void state_close(state_t *st) {
+    if (!st) return;
+    state_t *prev = cur;
+    cur = st;
+    state_save();
+    cur = prev == st ? NULL : prev;
+    for (size_t i = 0; i < st->table_cap; i++) free(st->table[i].dst);
+    free(st->table);
+    free(st);
+}
+
+/**
+ * Start a full scan; files it does not meet are dropped by state_end_scan()
+ */
+void state_begin_scan(void) {
+    if (cur) cur->scan_gen++;
+}
+
+/**
+ * End a full scan: forget files that were deleted or no longer arranged, and
+ * files whose destination was removed so that the next scan restores it
+ */
+void state_end_scan(void) {
+    state_t *st = cur;
+    if (!st) return;
+    size_t removed = 0;
+    struct stat sb;
+    for (size_t i = 0; i < st->table_cap; i++) {
+        state_entry_t *e = &st->table[i];
+        if (e->ino && (e->seen != st->scan_gen || lstat(e->dst, &sb) < 0)) {
+            free(e->dst);
+            e->dst = NULL;
+            e->ino = 0;
+            removed++;
+        }
+    }
+    if (removed == 0) return;
+    // reinsert the rest so probe chains have no gaps
+    state_entry_t *old = st->table;
+    size_t cap = st->table_cap;
+    st->table = calloc(cap, sizeof(state_entry_t));
+    if (!st->table) { st->table = old; return; }
+    for (size_t i = 0; i < cap; i++)
+        if (old[i].ino) *find_slot(st->table, cap, old[i].dev, old[i].ino) = old[i];
+    free(old);
+    st->table_count -= removed;
+    st->dirty = 1;
+}
+
+/**
+ * 1 if this version of the file was already arranged to 'dst'
+ */
+int state_unchanged(const struct stat *sb, const char *dst) {
+    state_t *st = cur;
+    if (!st) return 0;
+    pthread_mutex_lock(&state_lock);
+    int same = 0;
+    state_entry_t *e = st->table ? find_slot(st->table, st->table_cap, (uint64_t)sb->st_dev, (uint64_t)sb->st_ino) : NULL;
+    if (e && e->ino != 0) {
+        e->seen = st->scan_gen;
+        same = e->size == (int64_t)sb->st_size &&
+               e->mtime_sec == (int64_t)sb->st_mtim.tv_sec &&
+               e->mtime_nsec == (int64_t)sb->st_mtim.tv_nsec &&
+               strcmp(e->dst, dst) == 0;
+    }
+    pthread_mutex_unlock(&state_lock);
+    return same;
+}
+
+/**
+ * Remember that this version of the file has been handled for 'dst'
+ */
+void state_record(const struct stat *sb, const char *dst) {
+    state_t *st = cur;
+    if (!st) return;
+    char *copy = strdup(dst);
+    if (!copy) return;
+    pthread_mutex_lock(&state_lock);
+    state_entry_t *e = insert(st, (uint64_t)sb->st_dev, (uint64_t)sb->st_ino);
+    if (!e) {
+        pthread_mutex_unlock(&state_lock);
+        free(copy);
+        return;
+    }
+    free(e->dst);
+    e->dst = copy;
+    e->size = sb->st_size;
+    e->mtime_sec = sb->st_mtim.tv_sec;
+    e->mtime_nsec = sb->st_mtim.tv_nsec;
+    e->seen = st->scan_gen;
+    st->dirty = 1;
+    pthread_mutex_unlock(&state_lock);
+}
+
+/**
+ * Write the state if it changed: to a temporary file, then rename over the old one
+ */
+int state_save(void) {
+    state_t *st = cur;
+    if (!st || !st->dirty) return 0;
+    char tmp[PATH_MAX + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", st->file);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    FILE *fp = fd < 0 ? NULL : fdopen(fd, "wb");
+    if (!fp) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    uint32_t version = STATE_VERSION;
+    uint64_t count = st->table_count;
+    int ok = fwrite(STATE_MAGIC, 4, 1, fp) == 1 &&
+             fwrite(&version, sizeof(version), 1, fp) == 1 &&
+             fwrite(&count, sizeof(count), 1, fp) == 1;
+    for (size_t i = 0; ok && i < st->table_cap; i++) {
+        state_entry_t *e = &st->table[i];
+        if (!e->ino) continue;
+        state_rec_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.dev = e->dev;
+        rec.ino = e->ino;
+        rec.size = e->size;
+        rec.mtime_sec = e->mtime_sec;
+        rec.mtime_nsec = e->mtime_nsec;
+        rec.dst_len = (uint32_t)strlen(e->dst);
+        ok = fwrite(&rec, sizeof(rec), 1, fp) == 1 &&
+             fwrite(e->dst, rec.dst_len, 1, fp) == 1;
+    }
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok || rename(tmp, st->file) < 0) {
+        unlink(tmp);
+        return -1;
+    }
+    st->dirty = 0;
+    return 0;
+}
@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include "header.h"  // daemon_t, state_t, watch_set_t, arrange_directory, parse_config
+
+#define SUPERVISOR_STAGGER_MS 50   // spacing of the first scans of newly added directories
+
+extern daemon_config_t *current_cfg;
+extern bool current_first_run;
+
+// One monitored directory
+typedef struct {
+    daemon_t         d;
+    state_t         *state;
+    watch_set_t     *watch;         // inotify mode; NULL when scanning on the interval
+    bool             first_run;     // the first scan is not logged
+    long long        due_ms;        // next full scan (monotonic), -1 = none scheduled
+    struct timespec  cfg_mtime;     // config version last applied
+    int              seen;          // still in the registry
+} monitor_t;
+
+static monitor_t **monitors = NULL;
+static int monitor_count = 0;
+static int monitor_cap = 0;
+static watcher_t *watcher = NULL;   // one inotify instance for every tree
+
+// Forward declarations
+static void registry_file(char *buf, size_t size, const char *name);
+static monitor_t *find_monitor(const char *path);
+static void free_excludes(daemon_config_t *cfg);
+static void configure(monitor_t *m, long long due_ms);
+static monitor_t *monitor_new(const char *path, long long due_ms);
+static void monitor_free(monitor_t *m);
+static void load_registry(void);
+static void select_monitor(monitor_t *m);
+static long long run_due(long long now);
+static void check_watches(long long now);
+static void arm_timer(int tfd, long long wait_ms);
+
+// Helper: file in ~/.ssu_cleanupd
+static void registry_file(char *buf, size_t size, const char *name) {
+    struct passwd *pw = getpwuid(getuid());
+    const char *home = pw ? pw->pw_dir : "/";
+    snprintf(buf, size, "%s/.ssu_cleanupd", home);
+    mkdir(buf, 0755);
+    snprintf(buf, size, "%s/.ssu_cleanupd/%s", home, name);
+}
+
+static monitor_t *find_monitor(const char *path) {
+    for (int i = 0; i < monitor_count; i++) {
+        if (strcmp(monitors[i]->d.monitoring_path, path) == 0)
+            return monitors[i];
+    }
+    return NULL;
+}
+
+// Helper: free the exclude list parse_config() built
+static void free_excludes(daemon_config_t *cfg) {
+    for (int i = 0; i < cfg->exclude_count; i++) free(cfg->exclude_paths[i]);
+    free(cfg->exclude_paths);
+    cfg->exclude_paths = NULL;
+    cfg->exclude_count = 0;
+}
+
+// Helper: (re)load the config and the watches, and plan a full scan at 'due_ms'
+static void configure(monitor_t *m, long long due_ms) {
+    struct stat st;
+    if (stat(m->d.config_file, &st) == 0) m->cfg_mtime = st.st_mtim;
+    // the watches still point at the old excludes: drop them first
+    if (m->watch) {
+        watch_remove(watcher, m->watch);
+        m->watch = NULL;
+    }
+    free_excludes(&m->d.cfg);
+    parse_config(m->d.config_file, &m->d.cfg);
+    m->d.pid = getpid();
+    m->d.cfg.pid = m->d.pid;
+    m->d.cfg.monitoring_path = m->d.monitoring_path;
+    free(m->d.output_path);
+    m->d.output_path = strdup(m->d.cfg.output_path ? m->d.cfg.output_path : "");
+    // excludes may have changed: watches are rebuilt
+    if (m->d.cfg.watch_mode == WATCH_INOTIFY && watcher)
+        m->watch = watch_add(watcher, &m->d);   // NULL: falls back to interval scans
+    m->due_ms = due_ms;
+}
+
+static monitor_t *monitor_new(const char *path, long long due_ms) {
+    monitor_t *m = calloc(1, sizeof(monitor_t));
+    if (!m) return NULL;
+    char conf[PATH_MAX];
+    snprintf(conf, sizeof(conf), "%s/ssu_cleanupd.config", path);
+    m->d.monitoring_path = strdup(path);
+    m->d.config_file = strdup(conf);
+    m->first_run = true;
+    m->state = state_open(path);
+    configure(m, due_ms);
+    if (monitor_count == monitor_cap) {
+        monitor_cap = monitor_cap ? monitor_cap * 2 : 64;
+        monitors = realloc(monitors, sizeof(monitor_t*) * monitor_cap);
+    }
+    monitors[monitor_count++] = m;
+    return m;
+}
+
+static void monitor_free(monitor_t *m) {
+    if (m->watch) watch_remove(watcher, m->watch);
+    state_close(m->state);
+    free(m->d.monitoring_path);
+    free(m->d.output_path);
+    free(m->d.config_file);
+    free(m->d.cfg.extensions);
+    free(m->d.cfg.output_path);
+    free(m->d.cfg.start_time);
+    free_excludes(&m->d.cfg);
+    free(m);
+}
+
+// Helper: follow the registry: start new directories (their first scans
+// spread SUPERVISOR_STAGGER_MS apart), drop removed ones, and apply
+// configs rewritten by modify
+static void load_registry(void) {
+    int count = 0;
+    char **paths = registry_read(&count);
+    long long now = monotonic_ms();
+    int added = 0;
+    for (int i = 0; i < monitor_count; i++) monitors[i]->seen = 0;
+    for (int i = 0; i < count; i++) {
+        monitor_t *m = find_monitor(paths[i]);
+        if (!m) {
+            m = monitor_new(paths[i], now + (long long)added++ * SUPERVISOR_STAGGER_MS);
+        } else {
+            struct stat st;
+            if (stat(m->d.config_file, &st) == 0 &&
+                (st.st_mtim.tv_sec != m->cfg_mtime.tv_sec || st.st_mtim.tv_nsec != m->cfg_mtime.tv_nsec))
+                configure(m, now);
+        }
+        if (m) m->seen = 1;
+        free(paths[i]);
+    }
+    free(paths);
+    int n = 0;
+    for (int i = 0; i < monitor_count; i++) {
+        if (monitors[i]->seen) monitors[n++] = monitors[i];
+        else monitor_free(monitors[i]);
+    }
+    monitor_count = n;
+}
+
+// Helper: point the arrange functions at one directory
+static void select_monitor(monitor_t *m) {
+    state_use(m->state);
+    current_cfg = &m->d.cfg;
+    current_first_run = m->first_run;
+}
+
+// Helper: run the most overdue job (a full scan or an inotify burst), if any;
+// returns the milliseconds until the next one (0 = another is due, -1 = none)
+static long long run_due(long long now) {
+    monitor_t *best = NULL;
+    long long best_at = 0;
+    for (int i = 0; i < monitor_count; i++) {
+        monitor_t *m = monitors[i];
+        long long at = m->due_ms;
+        if (at < 0 && m->watch) {
+            long long wait = watch_due(m->watch, now);
+            if (wait >= 0) at = now + wait;
+        }
+        if (at >= 0 && (!best || at < best_at)) {
+            best = m;
+            best_at = at;
+        }
+    }
+    if (!best) return -1;
+    if (best_at > now) return best_at - now;
+
+    // one job per call, so signals and events are handled between scans
+    monitor_t *m = best;
+    select_monitor(m);
+    if (m->watch) {
+        // a pending full scan also covers the queued paths
+        if (m->due_ms >= 0) m->watch->rescan = 1;
+        watch_arrange(m->watch);
+        m->due_ms = -1;
+    } else {
+        arrange_directory(m->d.monitoring_path, m->d.output_path,
+                          m->d.cfg.exclude_paths, m->d.cfg.exclude_count,
+                          m->d.cfg.extensions, m->d.cfg.mode);
+        state_save();
+        // keep the phase, so staggered directories stay apart
+        long long interval = (long long)(m->d.cfg.time_interval > 0 ? m->d.cfg.time_interval : 1) * 1000;
+        m->due_ms += interval;
+        if (m->due_ms <= now) m->due_ms = now + interval;
+    }
+    m->first_run = false;
+    return 0;
+}
+
+// Helper: act on what the last events said about each tree
+static void check_watches(long long now) {
+    for (int i = 0; i < monitor_count; i++) {
+        monitor_t *m = monitors[i];
+        if (!m->watch) continue;
+        if (m->watch->gone) {
+            // directory removed: keep trying on the interval, as a daemon would
+            watch_remove(watcher, m->watch);
+            m->watch = NULL;
+            m->due_ms = now + (long long)m->d.cfg.time_interval * 1000;
+        } else if (m->watch->reload) {
+            configure(m, now);
+        }
+    }
+}
+
+// Helper: wake up after 'wait_ms' (disarmed when negative, 0 = handled by the caller)
+static void arm_timer(int tfd, long long wait_ms) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (wait_ms > 0) {
+        its.it_value.tv_sec = wait_ms / 1000;
+        its.it_value.tv_nsec = (wait_ms % 1000) * 1000000;
+    }
+    timerfd_settime(tfd, 0, &its, NULL);
+}
+
+/**
+ * Monitored paths listed in ~/.ssu_cleanupd/supervisor.list
+ */
+char **registry_read(int *out_count) {
+    char file[PATH_MAX];
+    registry_file(file, sizeof(file), "supervisor.list");
+    *out_count = 0;
+    char **paths = NULL;
+    FILE *fp = fopen(file, "r");
+    if (!fp) return NULL;
+    char line[PATH_MAX + 2];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] != '/') continue;
+        paths = realloc(paths, sizeof(char*) * (*out_count + 1));
+        paths[(*out_count)++] = strdup(line);
+    }
+    fclose(fp);
+    return paths;
+}
+
+/**
+ * Replace the registry (temporary file renamed over the old one)
+ */
+int registry_write(char **paths, int count) {
+    char file[PATH_MAX], tmp[PATH_MAX + 8];
+    registry_file(file, sizeof(file), "supervisor.list");
+    snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return -1;
+    for (int i = 0; i < count; i++) fprintf(fp, "%s\n", paths[i]);
+    if (fclose(fp) != 0 || rename(tmp, file) < 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * PID of the running supervisor (holder of the pid file lock), 0 if none
+ */
+pid_t supervisor_pid(void) {
+    char file[PATH_MAX];
+    registry_file(file, sizeof(file), "supervisor.pid");
+    int fd = open(file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    pid_t pid = 0;
+    if (fcntl(fd, F_GETLK, &fl) == 0 && fl.l_type != F_UNLCK) pid = fl.l_pid;
+    close(fd);
+    return pid;
+}
+
+/**
+ * Supervisor process: one epoll loop over a signalfd (SIGHUP reloads the
+ * registry and changed configs, SIGTERM stops), a timerfd for the next
+ * scheduled scan and the shared inotify instance. Writes its PID to
+ * 'ready_fd' (nothing if another supervisor runs) and only returns when stopped.
+ */
+void supervisor_main(int ready_fd) {
+    char pid_file[PATH_MAX];
+    registry_file(pid_file, sizeof(pid_file), "supervisor.pid");
+    int pid_fd = open(pid_file, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    if (pid_fd < 0 || fcntl(pid_fd, F_SETLK, &fl) < 0) {
+        close(ready_fd);
+        return;
+    }
+    pid_t self = getpid();
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "%d\n", (int)self);
+    if (ftruncate(pid_fd, 0) == 0) pwrite(pid_fd, buf, len, 0);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGHUP);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    int sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    watcher = watcher_new();   // NULL: inotify mode directories scan on the interval
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = sfd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, sfd, &ev);
+    ev.data.fd = tfd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev);
+    if (watcher) {
+        ev.data.fd = watcher_fd(watcher);
+        epoll_ctl(ep, EPOLL_CTL_ADD, ev.data.fd, &ev);
+    }
+
+    load_registry();
+    write(ready_fd, &self, sizeof(self));
+    close(ready_fd);
+
+    int stop = 0;
+    while (!stop) {
+        long long wait = run_due(monotonic_ms());
+        arm_timer(tfd, wait);
+        struct epoll_event evs[4];
+        int n = epoll_wait(ep, evs, 4, wait == 0 ? 0 : -1);
+        int reload = 0;
+        for (int i = 0; i < n; i++) {
+            int fd = evs[i].data.fd;
+            if (fd == sfd) {
+                struct signalfd_siginfo si;
+                while (read(sfd, &si, sizeof(si)) == sizeof(si)) {
+                    if (si.ssi_signo == SIGHUP) reload = 1;
+                    else stop = 1;
+                }
+            } else if (fd == tfd) {
+                uint64_t expirations;
+                read(tfd, &expirations, sizeof(expirations));
+            } else if (watcher && fd == watcher_fd(watcher)) {
+                watch_read(watcher);
+                check_watches(monotonic_ms());
+            }
+        }
+        if (reload && !stop) load_registry();
+    }
+
+    for (int i = 0; i < monitor_count; i++) monitor_free(monitors[i]);
+    free(monitors);
+    watcher_free(watcher);
+    close(ep);
+    close(tfd);
+    close(sfd);
+    unlink(pid_file);
+    close(pid_fd);
+}
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "header.h"  // daemon_t, watch_set_t, arrange_directory, arrange_paths
+
+#define WATCH_SETTLE_MS 100     // a burst ends after this long without events
+#define WATCH_BURST_MS  2000    // ... or after this long in total
+#define WATCH_BUF_SIZE  (64 * 1024)
+#define WATCH_DIR_MASK  (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF | \
+                         IN_ONLYDIR | IN_DONT_FOLLOW)
+
+extern bool current_first_run;
+
+// Watched directory
+typedef struct {
+    int          wd;       // inotify watch descriptor
+    char        *path;     // directory path
+    watch_set_t *set;      // monitored tree it belongs to
+} watch_dir_t;
+
+// One inotify instance, shared by every monitored tree of the process
+struct watcher {
+    int          fd;            // inotify instance
+    watch_dir_t *dirs;          // sorted by wd (the kernel hands them out increasing)
+    int          dir_count;
+    int          dir_cap;
+};
+
+// Forward declarations
+static watch_dir_t *find_dir(watcher_t *w, int wd);
+static int add_watch(watcher_t *w, watch_set_t *s, const char *path);
+static int add_watch_tree(watcher_t *w, watch_set_t *s, const char *path);
+static void remove_dir(watcher_t *w, int wd);
+static void queue_path(watch_set_t *s, const char *dir, const char *name);
+static void touch(watch_set_t *s);
+static int cmp_str(const void *a, const void *b);
+
+// Look up a watched directory by watch descriptor (binary search)
+static watch_dir_t *find_dir(watcher_t *w, int wd) {
+    int lo = 0, hi = w->dir_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (w->dirs[mid].wd == wd) return &w->dirs[mid];
+        if (w->dirs[mid].wd < wd) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return NULL;
+}
+
+// Watch one directory; 0 on success, -1 when inotify refuses (e.g. watch limit)
+static int add_watch(watcher_t *w, watch_set_t *s, const char *path) {
+    int wd = inotify_add_watch(w->fd, path, WATCH_DIR_MASK);
+    if (wd < 0) return errno == ENOENT || errno == ENOTDIR ? 0 : -1;
+    watch_dir_t *dir = find_dir(w, wd);
+    if (dir) {
+        // same directory seen again (renamed): keep the newest path
+        free(dir->path);
+        dir->path = strdup(path);
+        dir->set = s;
+        return 0;
+    }
+    if (w->dir_count == w->dir_cap) {
+        w->dir_cap = w->dir_cap ? w->dir_cap * 2 : 64;
+        w->dirs = realloc(w->dirs, sizeof(watch_dir_t) * w->dir_cap);
+    }
+    // keep the table sorted even if a reused wd comes out of order
+    int pos = w->dir_count;
+    while (pos > 0 && w->dirs[pos - 1].wd > wd) pos--;
+    memmove(&w->dirs[pos + 1], &w->dirs[pos], sizeof(watch_dir_t) * (w->dir_count - pos));
+    w->dirs[pos].wd = wd;
+    w->dirs[pos].path = strdup(path);
+    w->dirs[pos].set = s;
+    w->dir_count++;
+    return 0;
+}
+
+// Watch a directory and every subdirectory that is not excluded
+static int add_watch_tree(watcher_t *w, watch_set_t *s, const char *path) {
+    for (int i = 0; i < s->d->cfg.exclude_count; i++) {
+        const char *ex = s->d->cfg.exclude_paths[i];
+        if (strncmp(path, ex, strlen(ex)) == 0)
+            return 0;
+    }
+    if (add_watch(w, s, path) < 0) return -1;
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+    struct dirent *entry;
+    int ret = 0;
+    while (ret == 0 && (entry = readdir(dir))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        char sub[PATH_MAX];
+        snprintf(sub, sizeof(sub), "%s/%s", path, entry->d_name);
+        struct stat st;
+        if (lstat(sub, &st) == 0 && S_ISDIR(st.st_mode))
+            ret = add_watch_tree(w, s, sub);
+    }
+    closedir(dir);
+    return ret;
+}
+
+// Forget a directory whose watch the kernel dropped
+static void remove_dir(watcher_t *w, int wd) {
+    watch_dir_t *dir = find_dir(w, wd);
+    if (!dir) return;
+    int pos = dir - w->dirs;
+    free(dir->path);
+    memmove(&w->dirs[pos], &w->dirs[pos + 1], sizeof(watch_dir_t) * (w->dir_count - pos - 1));
+    w->dir_count--;
+}
+
+// Remember a changed path; duplicates are removed before arranging
+static void queue_path(watch_set_t *s, const char *dir, const char *name) {
+    if (s->queue_count == s->queue_cap) {
+        s->queue_cap = s->queue_cap ? s->queue_cap * 2 : 64;
+        s->queue = realloc(s->queue, sizeof(char*) * s->queue_cap);
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    s->queue[s->queue_count++] = strdup(path);
+    touch(s);
+}
+
+// Note the time of an event for coalescing
+static void touch(watch_set_t *s) {
+    s->last_ms = monotonic_ms();
+    if (s->first_ms == 0) s->first_ms = s->last_ms;
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/**
+ * Milliseconds on the monotonic clock
+ */
+long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Create an inotify instance for watch_add(); NULL if inotify is unusable
+ */
+watcher_t *watcher_new(void) {
+    watcher_t *w = calloc(1, sizeof(watcher_t));
+    if (!w) return NULL;
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0) {
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+/**
+ * Descriptor to poll for events
+ */
+int watcher_fd(const watcher_t *w) {
+    return w->fd;
+}
+
+void watcher_free(watcher_t *w) {
+    if (!w) return;
+    for (int i = 0; i < w->dir_count; i++) free(w->dirs[i].path);
+    free(w->dirs);
+    if (w->fd >= 0) close(w->fd);
+    free(w);
+}
+
+/**
+ * Watch the tree monitored by 'd'; NULL when inotify refuses (e.g. watch limit)
+ */
+watch_set_t *watch_add(watcher_t *w, daemon_t *d) {
+    watch_set_t *s = calloc(1, sizeof(watch_set_t));
+    if (!s) return NULL;
+    s->d = d;
+    if (add_watch_tree(w, s, d->monitoring_path) < 0) {
+        watch_remove(w, s);
+        return NULL;
+    }
+    return s;
+}
+
+/**
+ * Stop watching a tree and free its set
+ */
+void watch_remove(watcher_t *w, watch_set_t *s) {
+    int n = 0;
+    for (int i = 0; i < w->dir_count; i++) {
+        if (w->dirs[i].set == s) {
+            inotify_rm_watch(w->fd, w->dirs[i].wd);
+            free(w->dirs[i].path);
+        } else {
+            w->dirs[n++] = w->dirs[i];
+        }
+    }
+    w->dir_count = n;
+    for (int i = 0; i < s->queue_count; i++) free(s->queue[i]);
+    free(s->queue);
+    free(s);
+}
+
+/**
+ * Drain pending events into the queues of their sets
+ */
+void watch_read(watcher_t *w) {
+    char buf[WATCH_BUF_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(w->fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; ) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // events were lost: every tree is scanned again
+                for (int i = 0; i < w->dir_count; i++) {
+                    w->dirs[i].set->rescan = 1;
+                    touch(w->dirs[i].set);
+                }
+                continue;
+            }
+            watch_dir_t *dir = find_dir(w, ev->wd);
+            if (!dir) continue;
+            watch_set_t *s = dir->set;
+            const char *root = s->d->monitoring_path;
+            if (ev->mask & IN_IGNORED) {
+                if (strcmp(dir->path, root) == 0) s->gone = 1;
+                remove_dir(w, ev->wd);
+                continue;
+            }
+            if (ev->len == 0) continue;
+            const char *name = ev->name;
+            // the daemon's own files: only a rewritten config matters
+            if (strncmp(name, "ssu_cleanupd.", 13) == 0) {
+                if (strcmp(name, "ssu_cleanupd.config") == 0 && (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) &&
+                    strcmp(dir->path, root) == 0)
+                    s->reload = 1;
+                continue;
+            }
+            if (ev->mask & IN_ISDIR) {
+                if (!(ev->mask & (IN_CREATE | IN_MOVED_TO))) continue;
+                // new subtree: watch it, then arrange what it already holds
+                char sub[PATH_MAX];
+                snprintf(sub, sizeof(sub), "%s/%s", dir->path, name);
+                char parent[PATH_MAX];
+                snprintf(parent, sizeof(parent), "%s", dir->path);   // add_watch_tree may move 'dir'
+                if (add_watch_tree(w, s, sub) < 0) s->rescan = 1;
+                queue_path(s, parent, name);
+            } else if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                // files are arranged once the writer closes them
+                queue_path(s, dir->path, name);
+            }
+        }
+    }
+}
+
+/**
+ * Milliseconds until the set's burst should be arranged: it ends after
+ * WATCH_SETTLE_MS without events, or WATCH_BURST_MS after it began;
+ * -1 when nothing is pending
+ */
+long long watch_due(const watch_set_t *s, long long now_ms) {
+    if (s->first_ms == 0) return -1;
+    long long due = s->last_ms + WATCH_SETTLE_MS;
+    if (due > s->first_ms + WATCH_BURST_MS) due = s->first_ms + WATCH_BURST_MS;
+    return due > now_ms ? due - now_ms : 0;
+}
+
+/**
+ * Arrange the queued paths once each, or the whole tree after lost events
+ */
+void watch_arrange(watch_set_t *s) {
+    daemon_t *d = s->d;
+    if (s->rescan) {
+        arrange_directory(d->monitoring_path, d->output_path,
+                          d->cfg.exclude_paths, d->cfg.exclude_count,
+                          d->cfg.extensions, d->cfg.mode);
+    } else if (s->queue_count > 0) {
+        qsort(s->queue, s->queue_count, sizeof(char*), cmp_str);
+        int n = 0;
+        for (int i = 0; i < s->queue_count; i++) {
+            if (n > 0 && strcmp(s->queue[n - 1], s->queue[i]) == 0) free(s->queue[i]);
+            else s->queue[n++] = s->queue[i];
+        }
+        s->queue_count = n;
+        arrange_paths(s->queue, s->queue_count, d->output_path,
+                      d->cfg.exclude_paths, d->cfg.exclude_count,
+                      d->cfg.extensions, d->cfg.mode);
+    }
+    for (int i = 0; i < s->queue_count; i++) free(s->queue[i]);
+    s->queue_count = 0;
+    s->rescan = 0;
+    s->first_ms = s->last_ms = 0;
+    state_save();
+}
+
+/**
+ * Event-driven monitoring: watch the tree, arrange it once, then sleep in
+ * poll() until files are closed after writing, and arrange only those.
+ * Returns 0 when the config changes, -1 when inotify is unusable
+ * (the caller then rescans on the interval).
+ */
+int watch_loop(daemon_t *d) {
+    watcher_t *w = watcher_new();
+    if (!w) return -1;
+    // watches first, so nothing written during the first scan is missed
+    watch_set_t *s = watch_add(w, d);
+    if (!s) {
+        watcher_free(w);
+        return -1;
+    }
+    s->rescan = 1;
+    watch_arrange(s);
+    current_first_run = false;
+
+    int ret = 0;
+    struct pollfd pfd = { watcher_fd(w), POLLIN, 0 };
+    while (1) {
+        // idle: block until an event or SIGHUP arrives; during a burst,
+        // until it settles
+        long long wait = watch_due(s, monotonic_ms());
+        if (wait == 0) {
+            watch_arrange(s);
+            continue;
+        }
+        if (poll(&pfd, 1, (int)wait) < 0 && errno != EINTR) { ret = -1; break; }
+        watch_read(w);
+        if (s->gone) { ret = -1; break; }
+        // new settings (excludes, mode...): the caller re-reads the config
+        // and starts over with a full scan, which also covers queued paths
+        if (s->reload || reload_requested) break;
+    }
+    watch_remove(w, s);
+    watcher_free(w);
+    return ret;
+}
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include "header.h"
+
+#define CHECK_THREADS    8     // upper bound on group workers
+#define CHECK_MAX_REPORT 20    // problems printed per group
+#define EXT2_ROOT_INO    2
+
+/* -- Prototypes -- */
+static int bit_test(const uint64_t *set, uint64_t bit);
+static int bit_test_set(uint64_t *set, uint64_t bit);
+static void problem(uint32_t group, const char *fmt, ...);
+static void group_job(int idx, char *buf, void *arg);
+static void run_groups(void (*fn)(uint32_t group, char *buf));
+static void load_group(uint32_t group, char *buf);
+static void check_dir_block(uint32_t group, uint32_t ino, uint32_t blk, const char *data);
+static void check_ptr(uint32_t group, uint32_t ino, int is_dir, uint32_t blk, int depth, char *buf);
+static void scan_group(uint32_t group, char *buf);
+static void count_links(uint32_t group, char *buf);
+static void help(void);
+
+/* -- Problems found in one group, printed in group order -- */
+typedef struct {
+    char *text;
+    size_t len, cap;
+    uint64_t count;
+} GroupReport;
+
+static uint64_t *block_used;      // block bitmaps of all groups (bit = blk - s_first_data_block)
+static uint64_t *block_claimed;   // blocks referenced by metadata or an inode
+static uint64_t *inode_used;      // inode bitmaps of all groups (bit = ino - 1)
+static uint16_t *ref_count;       // directory entries naming each inode
+static uint16_t *link_count;      // i_links_count of each allocated inode
+static GroupReport *reports;
+static uint64_t inodes_checked, blocks_checked;
+static size_t itable_len;         // bytes of one group's inode table
+
+static int bit_test(const uint64_t *set, uint64_t bit) {
+    return (set[bit >> 6] >> (bit & 63)) & 1;
+}
+
+// bit_test_set: set a bit shared between workers; returns its previous value
+static int bit_test_set(uint64_t *set, uint64_t bit) {
+    uint64_t mask = (uint64_t)1 << (bit & 63);
+    return (__atomic_fetch_or(&set[bit >> 6], mask, __ATOMIC_RELAXED) & mask) != 0;
+}
+
+// problem: record one inconsistency against a group (only its worker writes there)
+static void problem(uint32_t group, const char *fmt, ...) {
+    GroupReport *r = &reports[group];
+    if (r->count++ >= CHECK_MAX_REPORT) return;
+    char line[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n >= sizeof(line)) n = sizeof(line) - 1;
+    if (r->len + n + 2 > r->cap) {
+        r->cap = (r->len + n + 2) * 2;
+        r->text = realloc(r->text, r->cap);
+        if (!r->text) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    memcpy(r->text + r->len, line, n);
+    r->len += n;
+    r->text[r->len++] = '\n';
+}
+
+// group_job: run_jobs callback running the current phase on one group
+static void (*phase_fn)(uint32_t group, char *buf);
+static void group_job(int idx, char *buf, void *arg) {
+    (void)arg;
+    phase_fn((uint32_t)idx, buf);
+}
+
+// run_groups: apply fn to every block group on worker threads
+static void run_groups(void (*fn)(uint32_t group, char *buf)) {
+    // large enough for a whole inode table or a bitmap block
+    size_t len = itable_len > (size_t)block_size ? itable_len : (size_t)block_size;
+    phase_fn = fn;
+    run_jobs((int)group_count, CHECK_THREADS, len, group_job, NULL);
+}
+
+// load_group: copy the group's bitmaps into the image-wide bitsets and
+// claim its bitmap and inode table blocks
+static void load_group(uint32_t group, char *buf) {
+    const ext2_group_desc *d = &gdt[group];
+    uint64_t nblocks = (uint64_t)sb.s_blocks_count - sb.s_first_data_block;
+    uint64_t first = (uint64_t)group * sb.s_blocks_per_group;
+    uint64_t count = first + sb.s_blocks_per_group > nblocks ? nblocks - first : sb.s_blocks_per_group;
+
+    // blocks_per_group and inodes_per_group are multiples of 8, so groups own whole bytes
+    if (read_blocks_as(d->bg_block_bitmap, 1, buf, TRACE_META) < 0)
+        problem(group, "group %" PRIu32 ": cannot read block bitmap %" PRIu32, group, d->bg_block_bitmap);
+    else
+        memcpy((char *)block_used + first / 8, buf, (count + 7) / 8);
+    if (read_blocks_as(d->bg_inode_bitmap, 1, buf, TRACE_META) < 0)
+        problem(group, "group %" PRIu32 ": cannot read inode bitmap %" PRIu32, group, d->bg_inode_bitmap);
+    else
+        memcpy((char *)inode_used + (uint64_t)group * sb.s_inodes_per_group / 8, buf,
+               sb.s_inodes_per_group / 8);
+
+    uint32_t meta[2] = { d->bg_block_bitmap, d->bg_inode_bitmap };
+    uint32_t table_blocks = (uint32_t)(itable_len / block_size);
+    for (uint32_t i = 0; i < 2 + table_blocks; i++) {
+        uint32_t blk = i < 2 ? meta[i] : d->bg_inode_table + (i - 2);
+        if (blk < sb.s_first_data_block || blk >= sb.s_blocks_count) {
+            problem(group, "group %" PRIu32 ": metadata block %" PRIu32 " out of range", group, blk);
+            continue;
+        }
+        if (bit_test_set(block_claimed, blk - sb.s_first_data_block))
+            problem(group, "group %" PRIu32 ": metadata block %" PRIu32 " used twice", group, blk);
+    }
+}
+
+// check_dir_block: rec_len / name_len chain of one directory block
+static void check_dir_block(uint32_t group, uint32_t ino, uint32_t blk, const char *data) {
+    int off = 0;
+    while (off < block_size) {
+        const ext2_dir_entry_2 *e = (const ext2_dir_entry_2 *)(data + off);
+        if (e->rec_len < 8 || e->rec_len % 4 || off + e->rec_len > block_size) {
+            problem(group, "inode %" PRIu32 ": block %" PRIu32 ": bad rec_len %u at offset %d",
+                    ino, blk, e->rec_len, off);
+            return;
+        }
+        if (e->inode) {
+            if (e->name_len + 8 > e->rec_len) {
+                problem(group, "inode %" PRIu32 ": block %" PRIu32 ": name_len %u exceeds rec_len %u at offset %d",
+                        ino, blk, e->name_len, e->rec_len, off);
+            } else if (e->inode > sb.s_inodes_count) {
+                problem(group, "inode %" PRIu32 ": entry '%.*s' names inode %" PRIu32 " out of range",
+                        ino, e->name_len, e->name, e->inode);
+            } else {
+                if (!bit_test(inode_used, e->inode - 1))
+                    problem(group, "inode %" PRIu32 ": entry '%.*s' names free inode %" PRIu32,
+                            ino, e->name_len, e->name, e->inode);
+                __atomic_fetch_add(&ref_count[e->inode - 1], 1, __ATOMIC_RELAXED);
+            }
+        }
+        off += e->rec_len;
+    }
+}
+
+// check_ptr: validate one block pointer and, for indirect blocks, everything below it.
+// buf holds one block per level: [0] data, [1..3] indirect
+static void check_ptr(uint32_t group, uint32_t ino, int is_dir, uint32_t blk, int depth, char *buf) {
+    if (!blk) return;
+    if (blk < sb.s_first_data_block || blk >= sb.s_blocks_count) {
+        problem(group, "inode %" PRIu32 ": block %" PRIu32 " out of range", ino, blk);
+        return;
+    }
+    uint64_t bit = blk - sb.s_first_data_block;
+    __atomic_fetch_add(&blocks_checked, 1, __ATOMIC_RELAXED);
+    if (!bit_test(block_used, bit))
+        problem(group, "inode %" PRIu32 ": block %" PRIu32 " not marked in use", ino, blk);
+    if (bit_test_set(block_claimed, bit)) {
+        // do not follow a shared indirect block: its children would all repeat the report
+        problem(group, "inode %" PRIu32 ": block %" PRIu32 " claimed more than once", ino, blk);
+        return;
+    }
+    if (depth == 0 && !is_dir) return;
+
+    char *data = buf + (size_t)depth * block_size;
+    if (read_blocks_as(blk, 1, data, depth ? TRACE_INDIRECT : TRACE_DIR) < 0) {
+        problem(group, "inode %" PRIu32 ": cannot read block %" PRIu32, ino, blk);
+        return;
+    }
+    if (depth == 0) {
+        STAT_ADD(dir_blocks, 1);
+        check_dir_block(group, ino, blk, data);
+        return;
+    }
+    const uint32_t *ptrs = (const uint32_t *)data;
+    for (int i = 0; i < block_size / 4; i++)
+        check_ptr(group, ino, is_dir, ptrs[i], depth - 1, buf);
+}
+
+// scan_group: check every allocated inode of the group
+static void scan_group(uint32_t group, char *buf) {
+    const ext2_group_desc *d = &gdt[group];
+    uint32_t table_blocks = (uint32_t)(itable_len / block_size);
+    if (read_blocks_as(d->bg_inode_table, table_blocks, buf, TRACE_INODE) < 0) {
+        problem(group, "group %" PRIu32 ": cannot read inode table", group);
+        return;
+    }
+    // pointer walks reuse buffers past the table
+    char *walk = malloc((size_t)4 * block_size);
+    if (!walk) { perror("malloc"); return; }
+    uint32_t first_ino = sb.s_rev_level ? sb.s_first_ino : 11;
+
+    for (uint32_t i = 0; i < sb.s_inodes_per_group; i++) {
+        uint32_t ino = group * sb.s_inodes_per_group + i + 1;
+        if (ino > sb.s_inodes_count) break;
+        if (!bit_test(inode_used, ino - 1)) continue;
+
+        ext2_inode inode;
+        size_t len = (size_t)inode_size < sizeof(inode) ? (size_t)inode_size : sizeof(inode);
+        memset(&inode, 0, sizeof(inode));
+        memcpy(&inode, buf + (size_t)i * inode_size, len);
+        __atomic_fetch_add(&inodes_checked, 1, __ATOMIC_RELAXED);
+        link_count[ino - 1] = inode.i_links_count;
+
+        // reserved inodes (bad blocks, resize, journal...) have their own layouts
+        if (ino < first_ino && ino != EXT2_ROOT_INO) continue;
+        if (inode.i_mode == 0) {
+            problem(group, "inode %" PRIu32 ": marked in use but has no mode", ino);
+            continue;
+        }
+        int dir = S_ISDIR(inode.i_mode);
+        if (!(dir || S_ISREG(inode.i_mode) || S_ISLNK(inode.i_mode))) continue;
+        // fast symlinks keep the target text in i_block
+        if (S_ISLNK(inode.i_mode) && inode.i_blocks == 0) continue;
+
+        for (int b = 0; b < EXT2_N_BLOCKS; b++) {
+            int depth = b < 12 ? 0 : b - 11;
+            check_ptr(group, ino, dir, inode.i_block[b], depth, walk);
+        }
+    }
+    free(walk);
+}
+
+// count_links: compare each inode's link count with the entries naming it
+static void count_links(uint32_t group, char *buf) {
+    (void)buf;
+    uint32_t first_ino = sb.s_rev_level ? sb.s_first_ino : 11;
+    for (uint32_t i = 0; i < sb.s_inodes_per_group; i++) {
+        uint32_t ino = group * sb.s_inodes_per_group + i + 1;
+        if (ino > sb.s_inodes_count) break;
+        if (ino < first_ino && ino != EXT2_ROOT_INO) continue;
+        if (!bit_test(inode_used, ino - 1)) continue;
+        if (link_count[ino - 1] != ref_count[ino - 1])
+            problem(group, "inode %" PRIu32 ": link count %u, but %u directory entries",
+                    ino, link_count[ino - 1], ref_count[ino - 1]);
+    }
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : check\n");
+}
+
+// cmd_check: read-only consistency check of the whole image
+void cmd_check(int argc, char *argv[]) {
+    (void)argv;
+    if (argc != 1) { help(); return; }
+
+    uint64_t nblocks = (uint64_t)sb.s_blocks_count - sb.s_first_data_block;
+    uint64_t block_words = ((uint64_t)group_count * sb.s_blocks_per_group + 63) / 64;
+    uint64_t inode_words = ((uint64_t)group_count * sb.s_inodes_per_group + 63) / 64;
+    itable_len = ((size_t)sb.s_inodes_per_group * inode_size + block_size - 1)
+                 / block_size * block_size;
+
+    block_used = calloc(block_words, sizeof(uint64_t));
+    block_claimed = calloc(block_words, sizeof(uint64_t));
+    inode_used = calloc(inode_words, sizeof(uint64_t));
+    ref_count = calloc(sb.s_inodes_count, sizeof(uint16_t));
+    link_count = calloc(sb.s_inodes_count, sizeof(uint16_t));
+    reports = calloc(group_count, sizeof(GroupReport));
+    inodes_checked = blocks_checked = 0;
+    if (!block_used || !block_claimed || !inode_used || !ref_count || !link_count || !reports) {
+        perror("calloc");
+    } else {
+        // every phase needs the previous one finished for all groups
+        run_groups(load_group);
+        run_groups(scan_group);
+        run_groups(count_links);
+
+        uint64_t total = 0;
+        for (uint32_t g = 0; g < group_count; g++) {
+            GroupReport *r = &reports[g];
+            if (r->len) fwrite(r->text, 1, r->len, OUT);
+            if (r->count > CHECK_MAX_REPORT)
+                fprintf(OUT, "... %" PRIu64 " more problems in group %" PRIu32 "\n",
+                       r->count - CHECK_MAX_REPORT, g);
+            total += r->count;
+        }
+        fprintf(OUT, "%s%" PRIu32 " groups, %" PRIu64 " inodes, %" PRIu64 " of %" PRIu64 " blocks in use by files: ",
+               total ? "\n" : "", group_count, inodes_checked, blocks_checked, nblocks);
+        if (total) fprintf(OUT, "%" PRIu64 " problems\n\n", total);
+        else fprintf(OUT, "clean\n\n");
+    }
+
+    if (reports)
+        for (uint32_t g = 0; g < group_count; g++) free(reports[g].text);
+    free(reports);
+    free(link_count);
+    free(ref_count);
+    free(inode_used);
+    free(block_claimed);
+    free(block_used);
+    reports = NULL;
+    link_count = ref_count = NULL;
+    inode_used = block_claimed = block_used = NULL;
+}
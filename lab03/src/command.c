@@ -1,18 +1,81 @@
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "header.h"
 
+// Command output streams; NULL means stdout / stderr
+__thread FILE *cmd_out = NULL;
+__thread FILE *cmd_err = NULL;
+
+// run_command: dispatch one tokenized command; returns 1 on exit
+int run_command(int argc, char *argv[]){
+    struct timespec start, end;
+
+    // call control function
+    if (tracing) trace_command(argv[0], 0);
+    // the background warmer pauses while a command runs
+    warm_hold();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(strcmp(argv[0], "tree") == 0){
+        cmd_tree(argc, argv);
+    }else if(strcmp(argv[0], "print") == 0){
+        cmd_print(argc, argv);
+    }else if(strcmp(argv[0], "extract") == 0){
+        cmd_extract(argc, argv);
+    }else if(strcmp(argv[0], "sum") == 0){
+        cmd_sum(argc, argv);
+    }else if(strcmp(argv[0], "grep") == 0){
+        cmd_grep(argc, argv);
+    }else if(strcmp(argv[0], "find") == 0){
+        cmd_find(argc, argv);
+    }else if(strcmp(argv[0], "stat") == 0){
+        cmd_stat(argc, argv);
+    }else if(strcmp(argv[0], "check") == 0){
+        cmd_check(argc, argv);
+    }else if(strcmp(argv[0], "export") == 0){
+        cmd_export(argc, argv);
+    }else if(strcmp(argv[0], "owner") == 0){
+        cmd_owner(argc, argv);
+    }else if(strcmp(argv[0], "dump-meta") == 0){
+        cmd_dump_meta(argc, argv);
+    }else if(strcmp(argv[0], "stats") == 0){
+        cmd_stats(argc, argv);
+        warm_release();
+        return 0;
+    }else if(strcmp(argv[0], "time") == 0){
+        int ret = cmd_time(argc, argv);
+        warm_release();
+        return ret;
+    }else if(strcmp(argv[0], "help") == 0){
+        cmd_help((argc > 1) ? argv[1] : NULL);
+    }else if(strcmp(argv[0], "exit") == 0){
+        warm_release();
+        return 1;
+    }else{
+        cmd_help(NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    warm_release();
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    stats_record_command(argv[0], seconds);
+    timing_record(argv[0], seconds);
+    return 0;
+}
+
 void cmd_loop(void){
     char line[MAX_LINE];
-    char *argv[MAX_ARG];
+    char *argv[MAX_ARG + 1];
     char *token;
     int argc;
 
     while(1){
-        // prompt
-        printf("20211407> ");
-		fflush(stdout);
+        // prompt (interactive only: 'export -o -' streams a tar on stdout)
+        if(isatty(STDIN_FILENO)){
+            printf("20211407> ");
+            fflush(stdout);
+        }
 
         // input
         if(fgets(line, sizeof(line), stdin) == NULL) break;
@@ -29,18 +92,8 @@ void cmd_loop(void){
             token = strtok(NULL, " \t\n");
         }
         argv[argc] = NULL;
+        if(argc == 0) continue;
 
-        // call control function
-		if(strcmp(argv[0], "tree") == 0){
-            cmd_tree(argc, argv);
-        }else if(strcmp(argv[0], "print") == 0){
-            cmd_print(argc, argv);
-        }else if(strcmp(argv[0], "help") == 0){
-            cmd_help((argc > 1) ? argv[1] : NULL);
-        }else if(strcmp(argv[0], "exit") == 0){
-            break;
-        }else{
-            cmd_help(NULL);
-        }
+        if(run_command(argc, argv)) break;
     }
 }
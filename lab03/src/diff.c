@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "header.h"
+
+#define DIFF_CHUNK (1 << 20)   // bytes compared per step (multiple of any block size)
+
+typedef struct DiffList DiffList;
+
+/* -- Prototypes -- */
+static void select_image(int idx);
+static int collect_child(const ext2_dir_entry_2 *e, void *arg);
+static int cmp_child(const void *a, const void *b);
+static int list_children(int idx, const ext2_inode *dir, DiffList *list);
+static int load_inodes(int idx, DiffList *list);
+static int same_dir(uint32_t ino_a, const ext2_inode *a, uint32_t ino_b, const ext2_inode *b);
+static int read_span(block_iter *it, char *buf, size_t bytes);
+static int same_data(const ext2_inode *a, const ext2_inode *b);
+static void report(char tag, const char *path, int dir, const char *why);
+static void compare_entry(const char *path, uint32_t ino_a, const ext2_inode *a,
+                          uint32_t ino_b, const ext2_inode *b);
+static void diff_dir(const char *path, uint32_t ino_a, const ext2_inode *a,
+                     uint32_t ino_b, const ext2_inode *b);
+static void help(const char *prog);
+
+/* -- Directory listing of one side -- */
+typedef struct {
+    uint32_t ino;
+    char name[EXT2_NAME_LEN+1];
+    ext2_inode inode;
+} DiffEntry;
+
+struct DiffList {
+    DiffEntry *v;
+    int count, cap;
+};
+
+static ext2_image images[2];
+static int current = 0;
+static int prune_subtrees = 0;
+static int added = 0, removed = 0, modified = 0;
+static uint64_t dirs_unchanged = 0;
+static char *buf_a = NULL, *buf_b = NULL;
+
+// select_image: make image 0 (old) or 1 (new) current, keeping both caches warm
+static void select_image(int idx) {
+    if (idx == current) return;
+    image_save(&images[current]);
+    image_use(&images[idx]);
+    current = idx;
+}
+
+// collect_child: dir_iterate callback gathering entries except '.' '..' 'lost+found'
+static int collect_child(const ext2_dir_entry_2 *e, void *arg) {
+    DiffList *list = arg;
+    char name[EXT2_NAME_LEN+1] = {0};
+    memcpy(name, e->name, e->name_len);
+    if (!strcmp(name, ".") || !strcmp(name, "..") || !strcmp(name, "lost+found"))
+        return 0;
+    if (list->count >= list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 16;
+        list->v = realloc(list->v, list->cap * sizeof *list->v);
+        if (!list->v) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    list->v[list->count].ino = e->inode;
+    memcpy(list->v[list->count].name, name, sizeof(name));
+    list->count++;
+    return 0;
+}
+
+static int cmp_child(const void *a, const void *b) {
+    return strcmp(((const DiffEntry *)a)->name, ((const DiffEntry *)b)->name);
+}
+
+// list_children: sorted entries of a directory of one image, with their inodes
+static int list_children(int idx, const ext2_inode *dir, DiffList *list) {
+    select_image(idx);
+    list->v = NULL;
+    list->count = list->cap = 0;
+    if (dir_iterate(dir, collect_child, list) < 0) return -1;
+    qsort(list->v, list->count, sizeof(*list->v), cmp_child);
+    return load_inodes(idx, list);
+}
+
+// load_inodes: fetch the inodes of all listed entries from one image in one batch
+static int load_inodes(int idx, DiffList *list) {
+    if (list->count == 0) return 0;
+    select_image(idx);
+    uint32_t *inos = malloc(list->count * sizeof(*inos));
+    ext2_inode *nodes = malloc(list->count * sizeof(*nodes));
+    if (!inos || !nodes) { perror("malloc"); exit(EXIT_FAILURE); }
+    for (int i = 0; i < list->count; i++) inos[i] = list->v[i].ino;
+    int ret = read_inodes(inos, list->count, nodes);
+    for (int i = 0; i < list->count; i++) list->v[i].inode = nodes[i];
+    free(nodes);
+    free(inos);
+    return ret;
+}
+
+// same_dir: a directory inode that did not change between the images
+// (same inode, mtime, size and block pointers) holds the same entries. Its
+// children may still differ: the kernel only updates a directory's mtime
+// when its own entries change, not when something below them does.
+static int same_dir(uint32_t ino_a, const ext2_inode *a, uint32_t ino_b, const ext2_inode *b) {
+    return ino_a == ino_b && a->i_mtime == b->i_mtime && a->i_size == b->i_size
+        && memcmp(a->i_block, b->i_block, sizeof(a->i_block)) == 0;
+}
+
+// read_span: next 'bytes' of a file from the current image (holes read as zeros)
+static int read_span(block_iter *it, char *buf, size_t bytes) {
+    uint32_t want = (uint32_t)((bytes + block_size - 1) / block_size);
+    uint32_t done = 0, pblk, len;
+    uint64_t lblk;
+    while (done < want && biter_next(it, &lblk, &pblk, &len, want - done) > 0) {
+        char *dst = buf + (size_t)done * block_size;
+        if (!pblk) memset(dst, 0, (size_t)len * block_size);
+        else if (read_blocks(pblk, len, dst) < 0) return -1;
+        done += len;
+    }
+    return done < want ? -1 : 0;
+}
+
+// same_data: compare file contents chunk by chunk; stops at the first difference
+static int same_data(const ext2_inode *a, const ext2_inode *b) {
+    // fast symlinks keep the target in i_block
+    if (S_ISLNK(a->i_mode) && a->i_blocks == 0 && b->i_blocks == 0)
+        return memcmp(a->i_block, b->i_block, a->i_size) == 0;
+
+    uint64_t remaining = inode_size64(a);
+    block_iter it_a, it_b;
+    int same = 1;
+    // the iterators size themselves by the block size of their own image
+    select_image(0);
+    biter_init(&it_a, a);
+    select_image(1);
+    biter_init(&it_b, b);
+    while (same && remaining > 0) {
+        size_t n = remaining < DIFF_CHUNK ? (size_t)remaining : DIFF_CHUNK;
+        select_image(0);
+        if (read_span(&it_a, buf_a, n) < 0) same = 0;
+        select_image(1);
+        if (same && read_span(&it_b, buf_b, n) < 0) same = 0;
+        if (same && memcmp(buf_a, buf_b, n) != 0) same = 0;
+        remaining -= n;
+    }
+    select_image(0);
+    biter_free(&it_a);
+    select_image(1);
+    biter_free(&it_b);
+    return same;
+}
+
+// report: one output line per change
+static void report(char tag, const char *path, int dir, const char *why) {
+    size_t len = strlen(path);
+    printf("%c %s%s", tag, path, (dir && len && path[len - 1] != '/') ? "/" : "");
+    if (why) printf(" [%s]", why);
+    printf("\n");
+    if (tag == '+') added++;
+    else if (tag == '-') removed++;
+    else modified++;
+}
+
+// compare_entry: an entry present in both images
+static void compare_entry(const char *path, uint32_t ino_a, const ext2_inode *a,
+                          uint32_t ino_b, const ext2_inode *b) {
+    if ((a->i_mode & S_IFMT) != (b->i_mode & S_IFMT)) {
+        report('M', path, 0, "type");
+        return;
+    }
+    char why[64] = "";
+    if ((a->i_mode & 07777) != (b->i_mode & 07777)) strcat(why, "mode,");
+    if (a->i_uid != b->i_uid || a->i_gid != b->i_gid) strcat(why, "owner,");
+
+    if (S_ISDIR(a->i_mode)) {
+        if (why[0]) { why[strlen(why) - 1] = '\0'; report('M', path, 1, why); }
+        diff_dir(path, ino_a, a, ino_b, b);
+        return;
+    }
+    if (S_ISREG(a->i_mode) || S_ISLNK(a->i_mode)) {
+        if (inode_size64(a) != inode_size64(b)) {
+            strcat(why, "size,");
+        } else if (a->i_mtime != b->i_mtime || ino_a != ino_b
+                   || memcmp(a->i_block, b->i_block, sizeof(a->i_block)) != 0) {
+            // same size but touched or moved: only the data can tell
+            if (!same_data(a, b)) strcat(why, "content,");
+        }
+    }
+    if (why[0]) { why[strlen(why) - 1] = '\0'; report('M', path, 0, why); }
+}
+
+// diff_dir: merge the sorted listings of one directory from both images
+static void diff_dir(const char *path, uint32_t ino_a, const ext2_inode *a,
+                     uint32_t ino_b, const ext2_inode *b) {
+    int same = same_dir(ino_a, a, ino_b, b);
+    if (same) dirs_unchanged++;
+    if (same && prune_subtrees) return;
+
+    // an unchanged directory is parsed once; only its children's inodes
+    // are fetched from the second image
+    DiffList la, lb;
+    int err = list_children(0, a, &la) < 0;
+    if (same) {
+        lb.count = lb.cap = la.count;
+        lb.v = malloc((la.count ? la.count : 1) * sizeof(*lb.v));
+        if (!lb.v) { perror("malloc"); exit(EXIT_FAILURE); }
+        memcpy(lb.v, la.v, la.count * sizeof(*lb.v));
+        err |= load_inodes(1, &lb) < 0;
+    } else {
+        err |= list_children(1, b, &lb) < 0;
+    }
+    if (err) fprintf(stderr, "diff: %s: read error\n", path);
+
+    size_t plen = strlen(path);
+    const char *sep = (plen && path[plen - 1] == '/') ? "" : "/";
+    int i = 0, j = 0;
+    while (i < la.count || j < lb.count) {
+        int c = i >= la.count ? 1 : j >= lb.count ? -1 : strcmp(la.v[i].name, lb.v[j].name);
+        const char *name = c <= 0 ? la.v[i].name : lb.v[j].name;
+        char sub[MAX_PATH];
+        snprintf(sub, sizeof(sub), "%s%s%s", path, sep, name);
+        if (c < 0) {
+            report('-', sub, is_dir(&la.v[i].inode), NULL);
+            i++;
+        } else if (c > 0) {
+            report('+', sub, is_dir(&lb.v[j].inode), NULL);
+            j++;
+        } else {
+            compare_entry(sub, la.v[i].ino, &la.v[i].inode, lb.v[j].ino, &lb.v[j].inode);
+            i++;
+            j++;
+        }
+    }
+    free(la.v);
+    free(lb.v);
+}
+
+// print usage
+static void help(const char *prog) {
+    fprintf(stderr, "Usage : %s diff <IMAGE_A> <IMAGE_B> [PATH] [-f] [--direct]\n", prog);
+}
+
+// diff_images: "ssu_ext2 diff" entry point; argv[0] is the program name
+int diff_images(int argc, char *argv[]) {
+    const char *files[2] = { NULL, NULL };
+    const char *path = "/";
+    int nfiles = 0, npath = 0, direct = 0;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0) prune_subtrees = 1;
+        else if (strcmp(argv[i], "--direct") == 0) direct = 1;
+        else if (nfiles < 2) files[nfiles++] = argv[i];
+        else if (npath++ == 0) path = argv[i];
+        else { help(argv[0]); return EXIT_FAILURE; }
+    }
+    if (nfiles < 2) { help(argv[0]); return EXIT_FAILURE; }
+
+    // open both images; image 1 stays current after the second init
+    if (init_ext2_structures(files[0], direct) < 0) return EXIT_FAILURE;
+    image_save(&images[0]);
+    if (init_ext2_structures(files[1], direct) < 0) { image_close(&images[0]); return EXIT_FAILURE; }
+    current = 1;
+
+    int status = EXIT_SUCCESS;
+    ext2_inode root_a, root_b;
+    select_image(0);
+    int ino_a = get_inode_by_path(path, &root_a);
+    select_image(1);
+    int ino_b = get_inode_by_path(path, &root_b);
+    buf_a = malloc(DIFF_CHUNK);
+    buf_b = malloc(DIFF_CHUNK);
+    if (!buf_a || !buf_b) {
+        perror("malloc");
+        status = EXIT_FAILURE;
+    } else if (ino_a < 0 && ino_b < 0) {
+        fprintf(stderr, "Error: '%s' is not in either image\n", path);
+        status = EXIT_FAILURE;
+    } else if (ino_a < 0) {
+        report('+', path, is_dir(&root_b), NULL);
+    } else if (ino_b < 0) {
+        report('-', path, is_dir(&root_a), NULL);
+    } else {
+        compare_entry(path, ino_a, &root_a, ino_b, &root_b);
+    }
+    if (status == EXIT_SUCCESS)
+        printf("\n%d added, %d removed, %d modified (%" PRIu64 " directories unchanged%s)\n",
+               added, removed, modified, dirs_unchanged, prune_subtrees ? ", not descended" : "");
+
+    free(buf_a);
+    free(buf_b);
+    select_image(0);
+    image_save(&images[0]);
+    image_close(&images[0]);
+    image_close(&images[1]);
+    return status;
+}
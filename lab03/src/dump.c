@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include "header.h"
+
+#define DUMP_CHUNK    (1 << 20)    // bytes per read and largest write
+
+/* -- Prototypes -- */
+static void mark(uint64_t *set, uint32_t blk, uint32_t count);
+static int is_marked(const uint64_t *set, uint32_t blk);
+static void mark_ptr(uint64_t *set, uint32_t blk, int depth, int keep_data, char *buf);
+static int mark_metadata(uint64_t *set, uint64_t *nblocks);
+static int write_all(int fd, const char *buf, size_t len, off_t off);
+static int copy_blocks(int fd, const uint64_t *set, uint64_t *written);
+static void help(void);
+
+// mark: flag blocks [blk, blk + count) for the dump, ignoring anything outside the image
+static void mark(uint64_t *set, uint32_t blk, uint32_t count) {
+    for (uint64_t b = blk; b < (uint64_t)blk + count && b < sb.s_blocks_count; b++)
+        set[b >> 6] |= (uint64_t)1 << (b & 63);
+}
+
+static int is_marked(const uint64_t *set, uint32_t blk) {
+    return (set[blk >> 6] >> (blk & 63)) & 1;
+}
+
+// mark_ptr: flag an indirect block and what it points to; data blocks only
+// with 'keep_data' (directories and symlink targets).
+// buf holds one block per level: [1..3] indirect
+static void mark_ptr(uint64_t *set, uint32_t blk, int depth, int keep_data, char *buf) {
+    if (!blk || blk >= sb.s_blocks_count) return;
+    if (depth == 0) {
+        if (keep_data) mark(set, blk, 1);
+        return;
+    }
+    mark(set, blk, 1);
+    char *data = buf + (size_t)depth * block_size;
+    if (read_blocks_as(blk, 1, data, TRACE_INDIRECT) < 0) return;
+    const uint32_t *ptrs = (const uint32_t *)data;
+    for (int i = 0; i < block_size / 4; i++)
+        mark_ptr(set, ptrs[i], depth - 1, keep_data, buf);
+}
+
+// mark_metadata: flag the boot block, superblock and descriptor copies, bitmaps,
+// inode tables, and every directory, indirect and symlink block; reserved
+// inodes are walked too, so the resize inode keeps its block map
+static int mark_metadata(uint64_t *set, uint64_t *nblocks) {
+    size_t itable_len = ((size_t)sb.s_inodes_per_group * inode_size + block_size - 1)
+                        / block_size * block_size;
+    uint32_t table_blocks = (uint32_t)(itable_len / block_size);
+    char *table = malloc(itable_len);
+    char *bitmap = malloc(block_size);
+    char *walk = malloc((size_t)4 * block_size);
+    if (!table || !bitmap || !walk) {
+        perror("malloc");
+        free(table);
+        free(bitmap);
+        free(walk);
+        return -1;
+    }
+    // the primary superblock sits in block 0 (4 KiB blocks) or 1 (1 KiB blocks)
+    mark(set, 0, sb.s_first_data_block + 1);
+    for (uint32_t g = 0; g < group_count; g++) {
+        const ext2_group_desc *d = &gdt[g];
+        // superblock / descriptor backups precede the group's own metadata
+        uint64_t start = (uint64_t)sb.s_first_data_block + (uint64_t)g * sb.s_blocks_per_group;
+        uint64_t first_meta = d->bg_block_bitmap;
+        if (d->bg_inode_bitmap < first_meta) first_meta = d->bg_inode_bitmap;
+        if (d->bg_inode_table < first_meta) first_meta = d->bg_inode_table;
+        if (first_meta > start && first_meta - start < sb.s_blocks_per_group)
+            mark(set, (uint32_t)start, (uint32_t)(first_meta - start));
+        mark(set, d->bg_block_bitmap, 1);
+        mark(set, d->bg_inode_bitmap, 1);
+        mark(set, d->bg_inode_table, table_blocks);
+
+        if (read_blocks_as(d->bg_inode_bitmap, 1, bitmap, TRACE_META) < 0 ||
+            read_blocks_as(d->bg_inode_table, table_blocks, table, TRACE_INODE) < 0) {
+            fprintf(ERR, "Error: cannot read inode table of group %" PRIu32 "\n", g);
+            continue;
+        }
+        for (uint32_t i = 0; i < sb.s_inodes_per_group; i++) {
+            uint32_t ino = g * sb.s_inodes_per_group + i + 1;
+            if (ino > sb.s_inodes_count) break;
+            if (!((bitmap[i / 8] >> (i % 8)) & 1)) continue;
+            ext2_inode inode;
+            size_t len = (size_t)inode_size < sizeof(inode) ? (size_t)inode_size : sizeof(inode);
+            memset(&inode, 0, sizeof(inode));
+            memcpy(&inode, table + (size_t)i * inode_size, len);
+            int keep_data = S_ISDIR(inode.i_mode) || S_ISLNK(inode.i_mode);
+            if (!(keep_data || S_ISREG(inode.i_mode))) continue;
+            // fast symlinks keep the target text in i_block
+            if (S_ISLNK(inode.i_mode) && inode.i_blocks == 0) continue;
+            for (int b = 0; b < EXT2_N_BLOCKS; b++)
+                mark_ptr(set, inode.i_block[b], b < 12 ? 0 : b - 11, keep_data, walk);
+        }
+    }
+    free(walk);
+    free(bitmap);
+    free(table);
+
+    *nblocks = 0;
+    for (uint64_t w = 0; w < ((uint64_t)sb.s_blocks_count + 63) / 64; w++)
+        *nblocks += __builtin_popcountll(set[w]);
+    return 0;
+}
+
+// write_all: pwrite the whole buffer
+static int write_all(int fd, const char *buf, size_t len, off_t off) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        off += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// copy_blocks: one ascending pass copying flagged runs of blocks to the same
+// offsets of 'fd'; all-zero blocks (unused inode table space) stay holes too
+static int copy_blocks(int fd, const uint64_t *set, uint64_t *written) {
+    uint32_t chunk = DUMP_CHUNK / block_size;
+    char *buf = malloc(DUMP_CHUNK);
+    if (!buf) { perror("malloc"); return -1; }
+    *written = 0;
+
+    uint32_t blk = 0;
+    while (blk < sb.s_blocks_count) {
+        if (!is_marked(set, blk)) {
+            // skip whole empty words of the bitset at once
+            if ((blk & 63) == 0 && set[blk >> 6] == 0) blk += 64;
+            else blk++;
+            continue;
+        }
+        uint32_t count = 1;
+        while (count < chunk && blk + count < sb.s_blocks_count && is_marked(set, blk + count))
+            count++;
+        if (read_blocks_as(blk, count, buf, TRACE_META) < 0) {
+            fprintf(ERR, "Error: cannot read blocks %" PRIu32 "-%" PRIu32 "\n", blk, blk + count - 1);
+            free(buf);
+            return -1;
+        }
+        // write the non-zero stretches of the run
+        uint32_t i = 0;
+        while (i < count) {
+            const char *p = buf + (size_t)i * block_size;
+            int zero = p[0] == 0 && memcmp(p, p + 1, block_size - 1) == 0;
+            if (zero) { i++; continue; }
+            uint32_t j = i + 1;
+            while (j < count) {
+                const char *q = buf + (size_t)j * block_size;
+                if (q[0] == 0 && memcmp(q, q + 1, block_size - 1) == 0) break;
+                j++;
+            }
+            if (write_all(fd, p, (size_t)(j - i) * block_size, (off_t)(blk + i) * block_size) < 0) {
+                free(buf);
+                return -1;
+            }
+            *written += j - i;
+            i = j;
+        }
+        blk += count;
+    }
+    free(buf);
+    return 0;
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : dump-meta <HOST_FILE>\n");
+}
+
+// cmd_dump_meta: write a sparse copy of the image holding only its metadata
+void cmd_dump_meta(int argc, char *argv[]) {
+    if (argc != 2) { help(); return; }
+    const char *out_path = argv[1];
+
+    // open without truncating first: the target must not be the image itself
+    int fd = open(out_path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(ERR, "Error: '%s': %s\n", out_path, strerror(errno));
+        return;
+    }
+    struct stat st, img;
+    if (fstat(fd, &st) == 0 && fstat(fs_fd, &img) == 0 &&
+        st.st_dev == img.st_dev && st.st_ino == img.st_ino) {
+        fprintf(ERR, "Error: '%s' is the open image\n", out_path);
+        close(fd);
+        return;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        fprintf(ERR, "Error: '%s' is not a regular file\n", out_path);
+        close(fd);
+        return;
+    }
+
+    uint64_t *set = calloc(((uint64_t)sb.s_blocks_count + 63) / 64, sizeof(uint64_t));
+    if (!set) { perror("calloc"); close(fd); return; }
+    uint64_t nblocks = 0, written = 0;
+    off_t size = (off_t)sb.s_blocks_count * block_size;
+    int ret = -1;
+    errno = 0;
+    if (ftruncate(fd, 0) < 0 || mark_metadata(set, &nblocks) < 0) goto out;
+    if (copy_blocks(fd, set, &written) < 0) goto out;
+    // holes up to the full image size
+    if (ftruncate(fd, size) < 0) goto out;
+    ret = 0;
+
+out:
+    if (ret < 0 && errno) fprintf(ERR, "Error: '%s': %s\n", out_path, strerror(errno));
+    else if (ret == 0)
+        fprintf(OUT, "%" PRIu64 " of %" PRIu32 " blocks are metadata, %" PRIu64 " written (%.1f MiB of %.1f MiB)\n\n",
+                nblocks, sb.s_blocks_count, written,
+                (double)written * block_size / (1 << 20), (double)size / (1 << 20));
+    close(fd);
+    free(set);
+}
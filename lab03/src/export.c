@@ -0,0 +1,428 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include "header.h"
+
+#define EXPORT_CHUNK   (1 << 20)    // bytes per coalesced read
+#define EXPORT_OUTBUF  (64 * 1024)  // headers and small files are gathered here
+#define EXPORT_KCOPY   (64 * 1024)  // runs at least this long go through the kernel
+#define TAR_BLOCK      512
+
+/* -- ustar header -- */
+typedef struct TarHeader {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+} TarHeader;
+
+// How file data reaches the output
+enum { COPY_RW, COPY_SPLICE, COPY_RANGE };
+
+/* -- Export state (one tar stream) -- */
+typedef struct {
+    int fd;
+    int copy_mode;
+    char *buf;                // image reads
+    char *out;                // pending output bytes
+    size_t out_len;
+    uint64_t written;
+    int dirs, files, failed;
+    struct { uint32_t ino; char *path; } *links;   // inodes with several names
+    int nlinks, links_cap;
+} Export;
+
+/* -- Prototypes -- */
+static int out_flush(Export *ex);
+static int out_write(Export *ex, const void *data, size_t len);
+static int out_zeros(Export *ex, uint64_t len);
+static void put_octal(char *field, size_t width, uint64_t value);
+static void pax_record(char *buf, size_t *len, size_t cap, const char *key, const char *value);
+static int put_header(Export *ex, const char *name, const ext2_inode *inode, char type,
+                      uint64_t size, const char *linkname);
+static int kernel_copy(Export *ex, uint32_t pblk, size_t bytes);
+static int put_data(Export *ex, const ext2_inode *inode);
+static int read_symlink(const ext2_inode *inode, char *target, size_t cap);
+static const char *first_link(Export *ex, uint32_t ino, const char *name);
+static int export_tree(Export *ex, uint32_t ino, const ext2_inode *inode, const char *name);
+static void help(void);
+
+// out_flush: write the gathered output
+static int out_flush(Export *ex) {
+    size_t done = 0;
+    while (done < ex->out_len) {
+        ssize_t n = write(ex->fd, ex->out + done, ex->out_len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += n;
+    }
+    ex->out_len = 0;
+    return 0;
+}
+
+// out_write: append to the output, writing large pieces straight through
+static int out_write(Export *ex, const void *data, size_t len) {
+    if (ex->out_len + len > EXPORT_OUTBUF) {
+        if (out_flush(ex) < 0) return -1;
+        if (len >= EXPORT_OUTBUF) {
+            ex->out_len = len;
+            char *saved = ex->out;
+            ex->out = (char *)data;
+            int ret = out_flush(ex);
+            ex->out = saved;
+            ex->written += len;
+            return ret;
+        }
+    }
+    memcpy(ex->out + ex->out_len, data, len);
+    ex->out_len += len;
+    ex->written += len;
+    return 0;
+}
+
+// out_zeros: append 'len' zero bytes (holes and block padding)
+static int out_zeros(Export *ex, uint64_t len) {
+    static const char zero[TAR_BLOCK * 8];
+    while (len > 0) {
+        size_t n = len < sizeof(zero) ? (size_t)len : sizeof(zero);
+        if (out_write(ex, zero, n) < 0) return -1;
+        len -= n;
+    }
+    return 0;
+}
+
+// put_octal: NUL-terminated, zero-padded octal field
+static void put_octal(char *field, size_t width, uint64_t value) {
+    snprintf(field, width, "%0*" PRIo64, (int)width - 1, value);
+}
+
+// pax_record: append "<len> key=value\n", where len counts the whole record
+static void pax_record(char *buf, size_t *len, size_t cap, const char *key, const char *value) {
+    size_t body = strlen(key) + strlen(value) + 3;   // ' ' '=' '\n'
+    size_t total = body + 1;
+    while (snprintf(NULL, 0, "%zu", total) + body > total) total++;
+    if (*len + total < cap)
+        *len += snprintf(buf + *len, cap - *len, "%zu %s=%s\n", total, key, value);
+}
+
+// put_header: one entry header, preceded by a pax extended header for
+// values ustar cannot hold (long names or targets, sizes >= 8 GiB, big ids)
+static int put_header(Export *ex, const char *name, const ext2_inode *inode, char type,
+                      uint64_t size, const char *linkname) {
+    TarHeader h;
+    char pax[3 * MAX_PATH];
+    size_t pax_len = 0;
+    char num[32];
+    memset(&h, 0, sizeof(h));
+
+    // ustar splits a long name at a '/' into prefix (155) and name (100)
+    size_t nlen = strlen(name);
+    if (nlen <= sizeof(h.name)) {
+        memcpy(h.name, name, nlen);
+    } else {
+        const char *cut = NULL;
+        for (const char *p = name; (p = strchr(p, '/')) != NULL; p++)
+            if ((size_t)(p - name) <= sizeof(h.prefix) && strlen(p + 1) <= sizeof(h.name) && p[1]) {
+                cut = p;
+                break;
+            }
+        if (cut) {
+            memcpy(h.prefix, name, cut - name);
+            memcpy(h.name, cut + 1, strlen(cut + 1));
+        } else {
+            memcpy(h.name, name, sizeof(h.name));
+            pax_record(pax, &pax_len, sizeof(pax), "path", name);
+        }
+    }
+    if (linkname) {
+        size_t llen = strlen(linkname);
+        memcpy(h.linkname, linkname, llen < sizeof(h.linkname) ? llen : sizeof(h.linkname));
+        if (llen > sizeof(h.linkname)) pax_record(pax, &pax_len, sizeof(pax), "linkpath", linkname);
+    }
+    if (size > 077777777777ull) {
+        snprintf(num, sizeof(num), "%" PRIu64, size);
+        pax_record(pax, &pax_len, sizeof(pax), "size", num);
+        size = 0;
+    }
+    // Linux keeps the high 16 bits of the ids in osd2 bytes 4..7
+    uint32_t uid = inode->i_uid | (uint32_t)(inode->i_osd2[4] | inode->i_osd2[5] << 8) << 16;
+    uint32_t gid = inode->i_gid | (uint32_t)(inode->i_osd2[6] | inode->i_osd2[7] << 8) << 16;
+    if (uid > 07777777) {
+        snprintf(num, sizeof(num), "%" PRIu32, uid);
+        pax_record(pax, &pax_len, sizeof(pax), "uid", num);
+        uid = 0;
+    }
+    if (gid > 07777777) {
+        snprintf(num, sizeof(num), "%" PRIu32, gid);
+        pax_record(pax, &pax_len, sizeof(pax), "gid", num);
+        gid = 0;
+    }
+
+    put_octal(h.mode, sizeof(h.mode), inode->i_mode & 07777);
+    put_octal(h.uid, sizeof(h.uid), uid);
+    put_octal(h.gid, sizeof(h.gid), gid);
+    put_octal(h.size, sizeof(h.size), size);
+    put_octal(h.mtime, sizeof(h.mtime), inode->i_mtime);
+    h.typeflag = type;
+    memcpy(h.magic, "ustar", 6);
+    memcpy(h.version, "00", 2);
+    if (type == '3' || type == '4') {
+        // old (8:8) or new (12:20) device number encoding
+        uint32_t dev = inode->i_block[0] ? inode->i_block[0] : inode->i_block[1];
+        uint32_t major = inode->i_block[0] ? (dev >> 8) & 0xff : (dev & 0xfff00) >> 8;
+        uint32_t minor = inode->i_block[0] ? dev & 0xff : (dev & 0xff) | ((dev >> 12) & 0xfff00);
+        put_octal(h.devmajor, sizeof(h.devmajor), major);
+        put_octal(h.devminor, sizeof(h.devminor), minor);
+    }
+
+    if (pax_len > 0) {
+        TarHeader x;
+        memset(&x, 0, sizeof(x));
+        snprintf(x.name, sizeof(x.name), "PaxHeaders/%.80s", h.name);
+        put_octal(x.mode, sizeof(x.mode), 0644);
+        put_octal(x.uid, sizeof(x.uid), 0);
+        put_octal(x.gid, sizeof(x.gid), 0);
+        put_octal(x.size, sizeof(x.size), pax_len);
+        put_octal(x.mtime, sizeof(x.mtime), inode->i_mtime);
+        x.typeflag = 'x';
+        memcpy(x.magic, "ustar", 6);
+        memcpy(x.version, "00", 2);
+        memset(x.chksum, ' ', sizeof(x.chksum));
+        unsigned sum = 0;
+        for (size_t i = 0; i < sizeof(x); i++) sum += ((unsigned char *)&x)[i];
+        snprintf(x.chksum, sizeof(x.chksum), "%06o", sum);
+        if (out_write(ex, &x, sizeof(x)) < 0 || out_write(ex, pax, pax_len) < 0
+            || out_zeros(ex, (TAR_BLOCK - pax_len % TAR_BLOCK) % TAR_BLOCK) < 0)
+            return -1;
+    }
+
+    memset(h.chksum, ' ', sizeof(h.chksum));
+    unsigned sum = 0;
+    for (size_t i = 0; i < sizeof(h); i++) sum += ((unsigned char *)&h)[i];
+    snprintf(h.chksum, sizeof(h.chksum), "%06o", sum);
+    return out_write(ex, &h, sizeof(h));
+}
+
+// kernel_copy: move image bytes to the output without a user-space copy;
+// -1 when this output cannot do it (the caller falls back to read + write)
+static int kernel_copy(Export *ex, uint32_t pblk, size_t bytes) {
+    if (out_flush(ex) < 0) return -1;
+    loff_t in = (loff_t)pblk * block_size;
+    size_t left = bytes;
+    while (left > 0) {
+        ssize_t n = ex->copy_mode == COPY_SPLICE
+                  ? splice(fs_fd, &in, ex->fd, NULL, left, SPLICE_F_MORE)
+                  : copy_file_range(fs_fd, &in, ex->fd, NULL, left, 0);
+        STAT_ADD(syscalls, 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        STAT_ADD(bytes_read, n);
+        left -= n;
+    }
+    ex->written += bytes - left;
+    if (left == 0) {
+        STAT_ADD(blocks_read, (bytes + block_size - 1) / block_size);
+        TRACE(pblk, (bytes + block_size - 1) / block_size, TRACE_DATA);
+        return 0;
+    }
+    // nothing moved yet: let the caller switch to read + write
+    if (left == bytes && (errno == EINVAL || errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP))
+        return 1;
+    return -1;
+}
+
+// put_data: stream a regular file's contents, then pad to a tar block
+static int put_data(Export *ex, const ext2_inode *inode) {
+    uint64_t size = inode_size64(inode), done = 0;
+    block_iter it;
+    uint64_t lblk;
+    uint32_t pblk, len;
+    int ret = 0;
+
+    biter_init(&it, inode);
+    while (ret == 0 && done < size && biter_next(&it, &lblk, &pblk, &len, EXPORT_CHUNK / block_size) > 0) {
+        size_t bytes = (size_t)len * block_size;
+        if (bytes > size - done) bytes = (size_t)(size - done);
+        if (!pblk) {
+            ret = out_zeros(ex, bytes);     // holes read back as zeros
+        } else {
+            int rc = 1;
+            if (ex->copy_mode != COPY_RW && bytes >= EXPORT_KCOPY && !direct_align) {
+                rc = kernel_copy(ex, pblk, bytes);
+                if (rc > 0) ex->copy_mode = COPY_RW;
+            }
+            if (rc < 0) ret = -1;
+            else if (rc > 0)
+                ret = read_blocks(pblk, len, ex->buf) < 0 ? -1 : out_write(ex, ex->buf, bytes);
+        }
+        done += bytes;
+    }
+    biter_free(&it);
+    // a short block map still needs exactly 'size' bytes in the stream
+    if (ret == 0 && done < size) ret = out_zeros(ex, size - done);
+    if (ret == 0) ret = out_zeros(ex, (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK);
+    return ret;
+}
+
+// read_symlink: target of a fast (in-inode) or block-based symlink
+static int read_symlink(const ext2_inode *inode, char *target, size_t cap) {
+    size_t len = inode->i_size < cap - 1 ? inode->i_size : cap - 1;
+    memset(target, 0, cap);
+    if (inode->i_blocks == 0) {
+        memcpy(target, inode->i_block, len < sizeof(inode->i_block) ? len : sizeof(inode->i_block));
+        return 0;
+    }
+    char *buf = malloc(block_size);
+    if (!buf || read_blocks(inode->i_block[0], 1, buf) < 0) { free(buf); return -1; }
+    memcpy(target, buf, len < (size_t)block_size ? len : (size_t)block_size);
+    free(buf);
+    return 0;
+}
+
+// first_link: earlier name of a multiply linked inode, recording this one if new
+static const char *first_link(Export *ex, uint32_t ino, const char *name) {
+    for (int i = 0; i < ex->nlinks; i++)
+        if (ex->links[i].ino == ino) return ex->links[i].path;
+    if (ex->nlinks >= ex->links_cap) {
+        ex->links_cap = ex->links_cap ? ex->links_cap * 2 : 16;
+        ex->links = realloc(ex->links, ex->links_cap * sizeof(*ex->links));
+        if (!ex->links) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    ex->links[ex->nlinks].ino = ino;
+    ex->links[ex->nlinks].path = strdup(name);
+    ex->nlinks++;
+    return NULL;
+}
+
+// export_tree: write 'inode' as 'name' and, for a directory, everything below it
+static int export_tree(Export *ex, uint32_t ino, const ext2_inode *inode, const char *name) {
+    uint16_t mode = inode->i_mode;
+
+    if (S_ISREG(mode)) {
+        const char *link = inode->i_links_count > 1 ? first_link(ex, ino, name) : NULL;
+        if (link) return put_header(ex, name, inode, '1', 0, link);
+        ex->files++;
+        if (put_header(ex, name, inode, '0', inode_size64(inode), NULL) < 0) return -1;
+        return put_data(ex, inode);
+    }
+    if (S_ISLNK(mode)) {
+        char target[MAX_PATH];
+        if (read_symlink(inode, target, sizeof(target)) < 0) {
+            fprintf(ERR, "export: %s: cannot read link target\n", name);
+            ex->failed++;
+            return 0;
+        }
+        return put_header(ex, name, inode, '2', 0, target);
+    }
+    if (S_ISCHR(mode) || S_ISBLK(mode) || S_ISFIFO(mode))
+        return put_header(ex, name, inode, S_ISCHR(mode) ? '3' : S_ISBLK(mode) ? '4' : '6', 0, NULL);
+    if (!is_dir(inode))
+        return 0;   // sockets have no tar representation
+
+    // directory names carry a trailing '/'; the image root is "./"
+    char dname[MAX_PATH];
+    snprintf(dname, sizeof(dname), "%s/", name);
+    ex->dirs++;
+    if (put_header(ex, dname, inode, '5', 0, NULL) < 0) return -1;
+
+    dir_child_list list;
+    dir_children(inode, &list);
+    uint32_t *inos = malloc((list.count ? list.count : 1) * sizeof *inos);
+    ext2_inode *children = malloc((list.count ? list.count : 1) * sizeof *children);
+    if (!inos || !children) { perror("malloc"); exit(EXIT_FAILURE); }
+    for (int i = 0; i < list.count; i++) inos[i] = list.v[i].ino;
+    read_inodes(inos, list.count, children);
+
+    int ret = 0;
+    for (int i = 0; ret == 0 && i < list.count; i++) {
+        char sub[MAX_PATH];
+        if (snprintf(sub, sizeof(sub), "%s/%s", name, list.v[i].name) >= (int)sizeof(sub)) {
+            fprintf(ERR, "export: %s/%s: path too long\n", name, list.v[i].name);
+            ex->failed++;
+            continue;
+        }
+        ret = export_tree(ex, inos[i], &children[i], sub);
+    }
+    free(children);
+    free(inos);
+    free(list.v);
+    return ret;
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : export <PATH> -o <FILE|->\n");
+}
+
+// cmd_export: entry point for export command
+void cmd_export(int argc, char *argv[]) {
+    if (argc != 4 || strcmp(argv[2], "-o") != 0) { help(); return; }
+    const char *path = argv[1];
+    const char *out_path = argv[3];
+
+    // validate path
+    ext2_inode inode;
+    int ino = get_inode_by_path(path, &inode);
+    if (ino < 0) { help(); return; }
+
+    Export ex;
+    memset(&ex, 0, sizeof(ex));
+    int to_stdout = strcmp(out_path, "-") == 0;
+    if (to_stdout) {
+        fflush(OUT);
+        ex.fd = fileno(OUT);
+    } else {
+        ex.fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (ex.fd < 0) {
+            fprintf(ERR, "Error: '%s': %s\n", out_path, strerror(errno));
+            return;
+        }
+    }
+    // pipes take spliced pages, regular files copied extents
+    struct stat st;
+    ex.copy_mode = COPY_RW;
+    if (fstat(ex.fd, &st) == 0)
+        ex.copy_mode = S_ISFIFO(st.st_mode) ? COPY_SPLICE : S_ISREG(st.st_mode) ? COPY_RANGE : COPY_RW;
+    // a larger pipe lets one splice move a whole read chunk (best effort)
+    if (ex.copy_mode == COPY_SPLICE) fcntl(ex.fd, F_SETPIPE_SZ, EXPORT_CHUNK);
+    ex.buf = malloc(EXPORT_CHUNK);
+    ex.out = malloc(EXPORT_OUTBUF);
+    if (!ex.buf || !ex.out) { perror("malloc"); exit(EXIT_FAILURE); }
+
+    // members are named after the exported path's last component
+    char base[EXT2_NAME_LEN+1];
+    path_name(path, base, sizeof(base));
+    if (ino == 2 || *base == '\0') strcpy(base, ".");
+
+    // two zero blocks end the archive
+    int ret = export_tree(&ex, (uint32_t)ino, &inode, base);
+    if (ret == 0) ret = out_zeros(&ex, 2 * TAR_BLOCK);
+    if (ret == 0) ret = out_flush(&ex);
+
+    FILE *msg = to_stdout ? ERR : OUT;
+    if (ret < 0) fprintf(ERR, "Error: '%s': %s\n", out_path, strerror(errno));
+    else fprintf(msg, "%d directories, %d files exported (%" PRIu64 " bytes)\n\n", ex.dirs, ex.files, ex.written);
+    if (!to_stdout) close(ex.fd);
+    for (int i = 0; i < ex.nlinks; i++) free(ex.links[i].path);
+    free(ex.links);
+    free(ex.out);
+    free(ex.buf);
+}
@@ -0,0 +1,698 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include "header.h"
+
+#define EXT2_NDIR_BLOCKS 12
+#define CACHE_SETS       1024      // cache holds CACHE_SETS * CACHE_WAYS blocks
+#define CACHE_WAYS       4
+
+/* -- Prototypes -- */
+static int cache_lookup(uint32_t blk, size_t off, size_t len, void *dst);
+static int cache_alloc(void);
+static void cache_insert(uint32_t blk, const void *src);
+static int cmp_u32(const void *a, const void *b);
+static void bounce_free(void *p);
+static char *bounce_get(size_t len);
+static ssize_t direct_pread(void *buf, size_t len, off_t off);
+static int fetch_blocks(uint32_t blk, uint32_t count, void *buf);
+static int batch_pread(read_req *reqs, int n);
+static uint32_t dir_lookup(const ext2_inode *dir, const char *name, size_t len);
+static int collect_entry(const ext2_dir_entry_2 *e, void *arg);
+static int load_indirect(block_iter *it, int depth, uint32_t blk);
+
+/* -- Walkers for the open image's block size (see DEFINE_BLOCK_OPS) -- */
+typedef struct block_ops {
+    int (*dir_scan)(const char *buf, int (*fn)(const ext2_dir_entry_2 *e, void *arg), void *arg);
+    uint32_t (*dir_find)(const char *buf, const char *name, size_t len);
+    int (*next_run)(block_iter *it, uint64_t *lblk, uint32_t *pblk, uint32_t *len, uint32_t max);
+} block_ops;
+
+static const block_ops *ops;
+
+/* -- Metadata block cache (set-associative, LRU within a set) -- */
+typedef struct { uint32_t tag; uint32_t age; } cache_slot;   // tag = blk + 1, 0 = empty
+static cache_slot *cache_slots = NULL;
+static char *cache_data = NULL;
+static uint32_t cache_clock = 0;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// cache_lookup: copy part of a cached block into dst; 1 on hit
+static int cache_lookup(uint32_t blk, size_t off, size_t len, void *dst) {
+    int hit = 0;
+    pthread_mutex_lock(&cache_lock);
+    if (cache_slots) {
+        cache_slot *set = &cache_slots[(blk % CACHE_SETS) * CACHE_WAYS];
+        for (int w = 0; w < CACHE_WAYS; w++) {
+            if (set[w].tag == blk + 1) {
+                size_t slot = (set - cache_slots) + w;
+                memcpy(dst, cache_data + slot * block_size + off, len);
+                set[w].age = ++cache_clock;
+                hit = 1;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+    if (hit) STAT_ADD(cache_hits, 1);
+    else STAT_ADD(cache_misses, 1);
+    return hit;
+}
+
+// cache_alloc: allocate the cache on first use (cache_lock held)
+static int cache_alloc(void) {
+    if (cache_slots) return 0;
+    cache_slots = calloc((size_t)CACHE_SETS * CACHE_WAYS, sizeof(*cache_slots));
+    cache_data = malloc((size_t)CACHE_SETS * CACHE_WAYS * block_size);
+    if (!cache_slots || !cache_data) {
+        free(cache_slots);
+        free(cache_data);
+        cache_slots = NULL;
+        cache_data = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// cache_insert: store a block, evicting the least recently used way
+static void cache_insert(uint32_t blk, const void *src) {
+    pthread_mutex_lock(&cache_lock);
+    if (cache_alloc() < 0) {
+        pthread_mutex_unlock(&cache_lock);
+        return;
+    }
+    cache_slot *set = &cache_slots[(blk % CACHE_SETS) * CACHE_WAYS];
+    int victim = 0;
+    for (int w = 0; w < CACHE_WAYS; w++) {
+        if (set[w].tag == blk + 1 || set[w].tag == 0) { victim = w; break; }
+        if (set[w].age < set[victim].age) victim = w;
+    }
+    size_t slot = (set - cache_slots) + victim;
+    memcpy(cache_data + slot * block_size, src, block_size);
+    set[victim].tag = blk + 1;
+    set[victim].age = ++cache_clock;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// cache_fill: store a prefetched block only in an empty way, as the oldest
+// entry of its set, so it never displaces a block a command has used;
+// 1 if stored
+int cache_fill(uint32_t blk, const void *src) {
+    int stored = 0;
+    pthread_mutex_lock(&cache_lock);
+    if (cache_alloc() == 0) {
+        cache_slot *set = &cache_slots[(blk % CACHE_SETS) * CACHE_WAYS];
+        int free_way = -1;
+        for (int w = 0; w < CACHE_WAYS; w++) {
+            if (set[w].tag == blk + 1) { free_way = -1; break; }
+            if (set[w].tag == 0 && free_way < 0) free_way = w;
+        }
+        if (free_way >= 0) {
+            size_t slot = (set - cache_slots) + free_way;
+            memcpy(cache_data + slot * block_size, src, block_size);
+            set[free_way].tag = blk + 1;
+            set[free_way].age = 0;
+            stored = 1;
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return stored;
+}
+
+// cache_capacity: number of blocks the cache holds
+uint32_t cache_capacity(void) {
+    return (uint32_t)CACHE_SETS * CACHE_WAYS;
+}
+
+// image_save: move the open image and its block cache into img;
+// the next init_ext2_structures() starts with an empty cache
+void image_save(ext2_image *img) {
+    img->fd = fs_fd;
+    img->sb = sb;
+    img->gdt = gdt;
+    img->group_count = group_count;
+    img->block_size = block_size;
+    img->inode_size = inode_size;
+    img->direct_align = direct_align;
+    pthread_mutex_lock(&cache_lock);
+    img->cache_slots = cache_slots;
+    img->cache_data = cache_data;
+    img->cache_clock = cache_clock;
+    cache_slots = NULL;
+    cache_data = NULL;
+    cache_clock = 0;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// image_use: make a saved image current (the current one must be saved first)
+void image_use(const ext2_image *img) {
+    fs_fd = img->fd;
+    sb = img->sb;
+    gdt = img->gdt;
+    gd = gdt[0];
+    group_count = img->group_count;
+    block_size = img->block_size;
+    inode_size = img->inode_size;
+    direct_align = img->direct_align;
+    select_block_ops();
+    pthread_mutex_lock(&cache_lock);
+    cache_slots = img->cache_slots;
+    cache_data = img->cache_data;
+    cache_clock = img->cache_clock;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// image_close: release a saved image that is not current
+void image_close(ext2_image *img) {
+    free(img->cache_slots);
+    free(img->cache_data);
+    free(img->gdt);
+    close(img->fd);
+    memset(img, 0, sizeof(*img));
+    img->fd = -1;
+}
+
+/* -- O_DIRECT bounce buffer, one per thread -- */
+typedef struct { char *buf; size_t len, align; } bounce_buf;
+static pthread_key_t bounce_key;
+static pthread_once_t bounce_once = PTHREAD_ONCE_INIT;
+
+static void bounce_free(void *p) {
+    bounce_buf *b = p;
+    free(b->buf);
+    free(b);
+}
+
+static void bounce_setup(void) {
+    pthread_key_create(&bounce_key, bounce_free);
+}
+
+// bounce_get: aligned buffer of at least len bytes for the calling thread
+static char *bounce_get(size_t len) {
+    pthread_once(&bounce_once, bounce_setup);
+    bounce_buf *b = pthread_getspecific(bounce_key);
+    if (!b) {
+        if (!(b = calloc(1, sizeof(*b)))) return NULL;
+        pthread_setspecific(bounce_key, b);
+    }
+    if (b->len < len || b->align < (size_t)direct_align) {
+        void *p;
+        if (posix_memalign(&p, direct_align, len) != 0) return NULL;
+        free(b->buf);
+        b->buf = p;
+        b->len = len;
+        b->align = direct_align;
+    }
+    return b->buf;
+}
+
+// direct_pread: O_DIRECT needs offset, length and buffer aligned to the sector,
+// so widen the range and read through the bounce buffer unless already aligned
+static ssize_t direct_pread(void *buf, size_t len, off_t off) {
+    size_t a = direct_align;
+    if ((uintptr_t)buf % a == 0 && (size_t)off % a == 0 && len % a == 0)
+        return pread(fs_fd, buf, len, off);
+
+    off_t start = off - (off_t)((size_t)off % a);
+    size_t head = off - start;
+    size_t span = (head + len + a - 1) / a * a;
+    char *tmp = bounce_get(span);
+    if (!tmp) { errno = ENOMEM; return -1; }
+    ssize_t n = pread(fs_fd, tmp, span, start);
+    if (n <= (ssize_t)head) return n < 0 ? -1 : 0;
+    n -= head;
+    if ((size_t)n > len) n = len;
+    memcpy(buf, tmp + head, n);
+    return n;
+}
+
+// image_pread: every image read ends up here so it can be counted
+ssize_t image_pread(void *buf, size_t len, off_t off) {
+    ssize_t n = direct_align ? direct_pread(buf, len, off) : pread(fs_fd, buf, len, off);
+    STAT_ADD(syscalls, 1);
+    if (n > 0) STAT_ADD(bytes_read, n);
+    return n;
+}
+
+// read_block: read a metadata block through the block cache
+// (callers trace the access, they know what the block holds)
+int read_block(uint32_t blk, void *buf) {
+    if (cache_lookup(blk, 0, block_size, buf)) return 0;
+    if (fetch_blocks(blk, 1, buf) < 0) return -1;
+    cache_insert(blk, buf);
+    return 0;
+}
+
+// read_blocks: read file data blocks, bypassing the cache
+int read_blocks(uint32_t blk, uint32_t count, void *buf) {
+    return read_blocks_as(blk, count, buf, TRACE_DATA);
+}
+
+// read_blocks_as: uncached read traced as the given kind of block
+int read_blocks_as(uint32_t blk, uint32_t count, void *buf, int kind) {
+    TRACE(blk, count, kind);
+    return fetch_blocks(blk, count, buf);
+}
+
+// fetch_blocks: read 'count' physically contiguous blocks with one pread
+static int fetch_blocks(uint32_t blk, uint32_t count, void *buf) {
+    size_t len = (size_t)count * block_size;
+    off_t off = (off_t)blk * block_size;
+    char *p = buf;
+    STAT_ADD(blocks_read, count);
+    while (len > 0) {
+        ssize_t n = image_pread(p, len, off);
+        if (n <= 0) return -1;
+        p += n;
+        off += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// read_inode: read inode from the table of its block group
+int read_inode(uint32_t ino, ext2_inode *buf) {
+    if (ino == 0 || ino > sb.s_inodes_count) return -1;
+    uint32_t group = (ino - 1) / sb.s_inodes_per_group;
+    uint32_t index = (ino - 1) % sb.s_inodes_per_group;
+    if (group >= group_count) return -1;
+    uint64_t byte = (uint64_t)index * inode_size;
+    uint32_t blk = gdt[group].bg_inode_table + (uint32_t)(byte / block_size);
+    size_t in_blk = byte % block_size;
+    // on-disk inodes may be larger than the fields we parse
+    size_t len = (size_t)inode_size < sizeof(*buf) ? (size_t)inode_size : sizeof(*buf);
+    STAT_ADD(inode_reads, 1);
+    TRACE(blk, 1, TRACE_INODE);
+    memset(buf, 0, sizeof(*buf));
+    if (cache_lookup(blk, in_blk, len, buf)) return 0;
+
+    char *tmp = malloc(block_size);
+    if (!tmp) return -1;
+    int ret = fetch_blocks(blk, 1, tmp);
+    if (ret == 0) {
+        cache_insert(blk, tmp);
+        memcpy(buf, tmp + in_blk, len);
+    }
+    free(tmp);
+    return ret;
+}
+
+// read_batch: issue many independent data reads at once
+int read_batch(read_req *reqs, int n) {
+    for (int i = 0; i < n; i++)
+        TRACE((uint32_t)(reqs[i].off / block_size), reqs[i].len / block_size, TRACE_DATA);
+    return batch_pread(reqs, n);
+}
+
+// batch_pread: submit a batch through io_uring when enabled, else pread each
+static int batch_pread(read_req *reqs, int n) {
+    if (n <= 0) return 0;
+    // ring reads go straight into unaligned caller buffers, so not with O_DIRECT
+    if (__atomic_load_n(&use_uring, __ATOMIC_RELAXED) && !direct_align) return uring_read_batch(reqs, n);
+    int ret = 0;
+    for (int i = 0; i < n; i++) {
+        STAT_ADD(blocks_read, reqs[i].len / block_size);
+        if (image_pread(reqs[i].buf, reqs[i].len, reqs[i].off) != (ssize_t)reqs[i].len)
+            ret = -1;
+    }
+    return ret;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// read_inodes: fetch the inode-table blocks holding 'inos' in one batch
+int read_inodes(const uint32_t *inos, int n, ext2_inode *out) {
+    if (n <= 0) return 0;
+    uint32_t *blks = malloc(n * sizeof(*blks));
+    if (!blks) return -1;
+
+    // Map every inode to its table block, then dedupe in physical order
+    for (int i = 0; i < n; i++) {
+        uint32_t g = (inos[i] - 1) / sb.s_inodes_per_group;
+        uint32_t idx = (inos[i] - 1) % sb.s_inodes_per_group;
+        if (inos[i] == 0 || g >= group_count) { blks[i] = 0; continue; }
+        blks[i] = gdt[g].bg_inode_table + (uint32_t)(((uint64_t)idx * inode_size) / block_size);
+    }
+    uint32_t *uniq = malloc(n * sizeof(*uniq));
+    if (!uniq) { free(blks); return -1; }
+    memcpy(uniq, blks, n * sizeof(*uniq));
+    qsort(uniq, n, sizeof(*uniq), cmp_u32);
+    int nu = 0;
+    for (int i = 0; i < n; i++)
+        if (uniq[i] && (nu == 0 || uniq[nu - 1] != uniq[i])) uniq[nu++] = uniq[i];
+
+    char *data = malloc((size_t)nu * block_size);
+    read_req *reqs = malloc(nu * sizeof(*reqs));
+    int ret = (data && reqs) ? 0 : -1;
+    int nreq = 0;
+    // only the blocks missing from the cache go into the batch
+    for (int i = 0; ret == 0 && i < nu; i++) {
+        char *dst = data + (size_t)i * block_size;
+        TRACE(uniq[i], 1, TRACE_INODE);
+        if (cache_lookup(uniq[i], 0, block_size, dst)) continue;
+        reqs[nreq].off = (off_t)uniq[i] * block_size;
+        reqs[nreq].len = block_size;
+        reqs[nreq].buf = dst;
+        nreq++;
+    }
+    if (ret == 0) ret = batch_pread(reqs, nreq);
+    for (int i = 0; ret == 0 && i < nreq; i++)
+        cache_insert((uint32_t)(reqs[i].off / block_size), reqs[i].buf);
+    STAT_ADD(inode_reads, n);
+
+    // Copy each inode out of its block
+    size_t len = (size_t)inode_size < sizeof(*out) ? (size_t)inode_size : sizeof(*out);
+    for (int i = 0; ret == 0 && i < n; i++) {
+        memset(&out[i], 0, sizeof(out[i]));
+        if (!blks[i]) continue;
+        uint32_t *hit = bsearch(&blks[i], uniq, nu, sizeof(*uniq), cmp_u32);
+        size_t in_blk = ((size_t)((inos[i] - 1) % sb.s_inodes_per_group) * inode_size) % block_size;
+        memcpy(&out[i], data + (size_t)(hit - uniq) * block_size + in_blk, len);
+    }
+    free(reqs);
+    free(data);
+    free(uniq);
+    free(blks);
+    return ret;
+}
+
+// is_dir: check inode mode for directory
+int is_dir(const ext2_inode *inode) {
+    return (inode->i_mode & EXT2_S_IFDIR) == EXT2_S_IFDIR;
+}
+
+// inode_size64: full file size; regular files keep the high 32 bits in i_dir_acl
+uint64_t inode_size64(const ext2_inode *inode) {
+    uint64_t size = inode->i_size;
+    if (S_ISREG(inode->i_mode))
+        size |= (uint64_t)inode->i_dir_acl << 32;
+    return size;
+}
+
+// dir_iterate: call fn for every live entry of a directory; stop when fn returns non-zero
+int dir_iterate(const ext2_inode *dir,
+                int (*fn)(const ext2_dir_entry_2 *e, void *arg), void *arg) {
+    block_iter it;
+    uint64_t lblk;
+    uint32_t pblk, len;
+    int ret = 0;
+
+    if (biter_init(&it, dir) < 0) return -1;
+    char *buf = malloc(block_size);
+    if (!buf) { biter_free(&it); return -1; }
+
+    while (!ret && biter_next(&it, &lblk, &pblk, &len, 1) > 0) {
+        if (!pblk) continue;
+        TRACE(pblk, 1, TRACE_DIR);
+        if (read_block(pblk, buf) < 0) continue;
+        STAT_ADD(dir_blocks, 1);
+        ret = ops->dir_scan(buf, fn, arg);
+    }
+    free(buf);
+    biter_free(&it);
+    return ret;
+}
+
+// dir_lookup: inode number of one path component in a directory, 0 if absent
+static uint32_t dir_lookup(const ext2_inode *dir, const char *name, size_t len) {
+    block_iter it;
+    uint64_t lblk;
+    uint32_t pblk, n, ino = 0;
+
+    if (biter_init(&it, dir) < 0) return 0;
+    char *buf = malloc(block_size);
+    if (!buf) { biter_free(&it); return 0; }
+    while (!ino && biter_next(&it, &lblk, &pblk, &n, 1) > 0) {
+        if (!pblk) continue;
+        TRACE(pblk, 1, TRACE_DIR);
+        if (read_block(pblk, buf) < 0) continue;
+        STAT_ADD(dir_blocks, 1);
+        ino = ops->dir_find(buf, name, len);
+    }
+    free(buf);
+    biter_free(&it);
+    return ino;
+}
+
+// get_inode_by_path: resolve path to inode, return inode number or -1
+int get_inode_by_path(const char *path, ext2_inode *inode) {
+    uint32_t cur_ino = 2;
+    ext2_inode cur;
+    if (read_inode(cur_ino, &cur) < 0) return -1;
+
+    // Handle root or current directory
+    if (strcmp(path, ".") == 0 || strcmp(path, "/") == 0) {
+        *inode = cur;
+        return cur_ino;
+    }
+
+    char *copy = strdup(path);
+    if (!copy) return -1;
+    char *save = NULL;
+    char *tok = strtok_r(copy, "/", &save);
+    // Traverse each component
+    while (tok) {
+        if (!is_dir(&cur)) break;
+        uint32_t ino = dir_lookup(&cur, tok, strlen(tok));
+        if (!ino || read_inode(ino, &cur) < 0)
+            break;
+        cur_ino = ino;
+        tok = strtok_r(NULL, "/", &save);
+    }
+    free(copy);
+    if (tok) return -1;
+    *inode = cur;
+    return cur_ino;
+}
+
+// path_name: last component of an image path, ignoring trailing '/';
+// empty for the root ("/", "." or nothing but slashes)
+void path_name(const char *path, char *name, size_t cap) {
+    size_t end = strlen(path);
+    while (end > 0 && path[end - 1] == '/') end--;
+    size_t start = end;
+    while (start > 0 && path[start - 1] != '/') start--;
+    size_t len = end - start;
+    if (len == 1 && path[start] == '.') len = 0;
+    if (len >= cap) len = cap - 1;
+    memcpy(name, path + start, len);
+    name[len] = '\0';
+}
+
+// collect_entry: dir_iterate callback gathering child entries
+static int collect_entry(const ext2_dir_entry_2 *e, void *arg) {
+    dir_child_list *list = arg;
+    char name[EXT2_NAME_LEN+1] = {0};
+    memcpy(name, e->name, e->name_len);
+    // Skip special entries
+    if (!strcmp(name, ".") || !strcmp(name, "..") || !strcmp(name, "lost+found"))
+        return 0;
+    if (list->count >= list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 8;
+        list->v = realloc(list->v, list->cap * sizeof *list->v);
+        if (!list->v) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    list->v[list->count].ino = e->inode;
+    memcpy(list->v[list->count].name, name, sizeof(name));
+    list->count++;
+    return 0;
+}
+
+// dir_children: entries of a directory except '.', '..' and 'lost+found';
+// the caller frees list->v
+int dir_children(const ext2_inode *dir, dir_child_list *list) {
+    list->v = NULL;
+    list->count = list->cap = 0;
+    return dir_iterate(dir, collect_entry, list);
+}
+
+// walk_tree: call fn for 'inode' and, if it is a directory, every entry below it (preorder)
+void walk_tree(const ext2_inode *inode, const char *path,
+               void (*fn)(const ext2_inode *inode, const char *path, void *arg), void *arg) {
+    fn(inode, path, arg);
+    if (!is_dir(inode)) return;
+
+    dir_child_list list;
+    dir_children(inode, &list);
+    size_t plen = strlen(path);
+    const char *sep = (plen && path[plen - 1] == '/') ? "" : "/";
+    for (int i = 0; i < list.count; i++) {
+        ext2_inode child;
+        char sub[MAX_PATH];
+        if (read_inode(list.v[i].ino, &child) < 0) continue;
+        snprintf(sub, sizeof(sub), "%s%s%s", path, sep, list.v[i].name);
+        walk_tree(&child, sub, fn, arg);
+    }
+    free(list.v);
+}
+
+// biter_init: prepare to walk the data blocks of an inode
+int biter_init(block_iter *it, const ext2_inode *inode) {
+    memset(it, 0, sizeof(*it));
+    it->inode = *inode;
+    it->nblocks = (inode_size64(inode) + block_size - 1) / block_size;
+    return 0;
+}
+
+// biter_free: release cached indirect blocks
+void biter_free(block_iter *it) {
+    for (int d = 0; d < 3; d++) {
+        free(it->ind[d]);
+        it->ind[d] = NULL;
+    }
+}
+
+// load_indirect: make sure the indirect block at 'depth' is cached
+static int load_indirect(block_iter *it, int depth, uint32_t blk) {
+    if (it->ind[depth] && it->ind_blk[depth] == blk) return 0;
+    if (!it->ind[depth] && !(it->ind[depth] = malloc(block_size))) return -1;
+    TRACE(blk, 1, TRACE_INDIRECT);
+    if (read_block(blk, it->ind[depth]) < 0) {
+        it->ind_blk[depth] = 0;
+        return -1;
+    }
+    it->ind_blk[depth] = blk;
+    return 0;
+}
+
+/* -- Block-size specialised walkers --
+ * DEFINE_BLOCK_OPS expands the directory-entry walk and the pointer-tree walk
+ * for one block size. With BS a constant, loop bounds, pointers per block and
+ * the index arithmetic fold at compile time (divisions become shifts and the
+ * contiguity scan over a leaf pointer array can be unrolled / vectorised).
+ * The 'any' variant uses the runtime block_size for other sizes. */
+#define DEFINE_BLOCK_OPS(S, BS)                                                          \
+/* dir_scan_S: call fn for every live entry of one directory block */                    \
+static int dir_scan_##S(const char *buf,                                                  \
+                        int (*fn)(const ext2_dir_entry_2 *e, void *arg), void *arg) {     \
+    int off = 0;                                                                         \
+    while (off < (BS)) {                                                                 \
+        const ext2_dir_entry_2 *e = (const ext2_dir_entry_2 *)(buf + off);               \
+        /* guard against corrupted chains */                                             \
+        if (e->rec_len < 8 || off + e->rec_len > (BS)) break;                            \
+        if (e->inode) {                                                                  \
+            int ret = fn(e, arg);                                                        \
+            if (ret) return ret;                                                         \
+        }                                                                                \
+        off += e->rec_len;                                                               \
+    }                                                                                    \
+    return 0;                                                                            \
+}                                                                                        \
+                                                                                         \
+/* dir_find_S: inode number of the entry called name in one directory block, or 0 */    \
+static uint32_t dir_find_##S(const char *buf, const char *name, size_t len) {            \
+    int off = 0;                                                                         \
+    while (off < (BS)) {                                                                 \
+        const ext2_dir_entry_2 *e = (const ext2_dir_entry_2 *)(buf + off);               \
+        if (e->rec_len < 8 || off + e->rec_len > (BS)) break;                            \
+        if (e->inode && e->name_len == len && memcmp(e->name, name, len) == 0)           \
+            return e->inode;                                                             \
+        off += e->rec_len;                                                               \
+    }                                                                                    \
+    return 0;                                                                            \
+}                                                                                        \
+                                                                                         \
+/* leaf_S: pointer array holding lblk's entry, with *idx its slot and *cnt the array     \
+ * length; NULL when lblk lies under a missing indirect block, *cnt = blocks it covers */ \
+static const uint32_t *leaf_##S(block_iter *it, uint64_t lblk, uint32_t *idx, uint64_t *cnt) { \
+    const uint64_t ppb = (BS) / sizeof(uint32_t);                                        \
+    uint64_t span;                                                                       \
+    int levels;                                                                          \
+                                                                                         \
+    if (lblk < EXT2_NDIR_BLOCKS) {                                                       \
+        *idx = (uint32_t)lblk;                                                           \
+        *cnt = EXT2_NDIR_BLOCKS;                                                         \
+        return it->inode.i_block;                                                        \
+    }                                                                                    \
+    lblk -= EXT2_NDIR_BLOCKS;                                                            \
+    if (lblk < ppb) {                                                                    \
+        levels = 1, span = ppb;                                                          \
+    } else if ((lblk -= ppb) < ppb * ppb) {                                              \
+        levels = 2, span = ppb * ppb;                                                    \
+    } else if ((lblk -= ppb * ppb) < ppb * ppb * ppb) {                                  \
+        levels = 3, span = ppb * ppb * ppb;                                              \
+    } else {                                                                             \
+        *cnt = 1;                                                                        \
+        return NULL;                                                                     \
+    }                                                                                    \
+    uint32_t blk = it->inode.i_block[EXT2_NDIR_BLOCKS + levels - 1];                     \
+                                                                                         \
+    /* Walk from the top-level indirect block down to the leaf */                        \
+    for (int depth = 0; depth < levels; depth++) {                                       \
+        if (!blk || load_indirect(it, depth, blk) < 0) {                                 \
+            *cnt = span - lblk % span;                                                   \
+            return NULL;                                                                 \
+        }                                                                                \
+        span /= ppb;                                                                     \
+        if (depth == levels - 1) break;                                                  \
+        blk = it->ind[depth][(lblk / span) % ppb];                                       \
+    }                                                                                    \
+    *idx = (uint32_t)(lblk % ppb);                                                       \
+    *cnt = ppb;                                                                          \
+    return it->ind[levels - 1];                                                          \
+}                                                                                        \
+                                                                                         \
+/* next_run_S: biter_next for this block size, scanning whole leaf arrays */             \
+static int next_run_##S(block_iter *it, uint64_t *lblk, uint32_t *pblk,                  \
+                        uint32_t *len, uint32_t max) {                                   \
+    if (it->next >= it->nblocks) return 0;                                               \
+    if (it->nblocks - it->next < max) max = (uint32_t)(it->nblocks - it->next);          \
+                                                                                         \
+    uint32_t first = 0, n = 0;                                                           \
+    while (n < max) {                                                                    \
+        uint32_t idx = 0;                                                                \
+        uint64_t cnt;                                                                    \
+        const uint32_t *p = leaf_##S(it, it->next + n, &idx, &cnt);                      \
+        if (!p) {                                                                        \
+            /* a missing indirect block is one hole over everything below it */          \
+            if (n > 0 && first) break;                                                   \
+            n = cnt > (uint64_t)(max - n) ? max : n + (uint32_t)cnt;                     \
+            continue;                                                                    \
+        }                                                                                \
+        uint32_t avail = (uint32_t)(cnt - idx), i = 0;                                   \
+        if (avail > max - n) avail = max - n;                                            \
+        if (n == 0) first = p[idx], i = 1;                                               \
+        if (first) {                                                                     \
+            const uint32_t want = first + n - idx;                                       \
+            while (i < avail && p[idx + i] == want + idx + i) i++;                       \
+        } else {                                                                         \
+            while (i < avail && p[idx + i] == 0) i++;                                    \
+        }                                                                                \
+        n += i;                                                                          \
+        if (i < avail) break;                                                            \
+    }                                                                                    \
+    *lblk = it->next;                                                                    \
+    *pblk = first;                                                                       \
+    *len = n;                                                                            \
+    it->next += n;                                                                       \
+    return 1;                                                                            \
+}                                                                                        \
+                                                                                         \
+static const block_ops block_ops_##S = { dir_scan_##S, dir_find_##S, next_run_##S };
+
+DEFINE_BLOCK_OPS(1k, 1024)
+DEFINE_BLOCK_OPS(2k, 2048)
+DEFINE_BLOCK_OPS(4k, 4096)
+DEFINE_BLOCK_OPS(any, block_size)
+
+static const block_ops *ops = &block_ops_any;
+
+// select_block_ops: pick the walkers matching the open image's block size
+void select_block_ops(void) {
+    switch (block_size) {
+    case 1024: ops = &block_ops_1k; break;
+    case 2048: ops = &block_ops_2k; break;
+    case 4096: ops = &block_ops_4k; break;
+    default:   ops = &block_ops_any; break;
+    }
+}
+
+// biter_next: return the next run of up to 'max' blocks that are either
+// physically contiguous or all holes (pblk == 0); 0 at end of file
+int biter_next(block_iter *it, uint64_t *lblk, uint32_t *pblk, uint32_t *len, uint32_t max) {
+    return ops->next_run(it, lblk, pblk, len, max);
+}
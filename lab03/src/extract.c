@@ -0,0 +1,265 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "header.h"
+
+#define EXTRACT_CHUNK   (1 << 20)   // bytes per coalesced read
+#define EXTRACT_THREADS 8           // upper bound on copy workers
+
+/* -- Prototypes -- */
+static int walk(ext2_inode *inode, const char *host_path);
+static int extract_symlink(ext2_inode *inode, const char *host_path);
+static int copy_data(ext2_inode *inode, int out_fd, char *buf);
+static int copy_file(ext2_inode *inode, const char *host_path, char *buf);
+static void set_times(int fd, const char *host_path, ext2_inode *inode);
+static void copy_job(int idx, char *buf, void *arg);
+static void add_job(ext2_inode *inode, const char *host_path);
+static void clear_jobs(void);
+static void help(void);
+
+/* -- File copy job -- */
+typedef struct {
+    ext2_inode inode;
+    char *host_path;
+} ExtractJob;
+
+typedef struct {
+    ext2_inode inode;
+    char *host_path;
+} DirFixup;
+
+static ExtractJob *jobs = NULL;
+static int job_count = 0, job_cap = 0;
+static DirFixup *dirs = NULL;
+static int dir_count = 0, dir_cap = 0;
+static int fail_count = 0;
+static int use_copy_range = 1;            // shared by the workers, accessed atomically
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;   // fail_count and error lines
+
+// add_job: queue a regular file for the copy workers
+static void add_job(ext2_inode *inode, const char *host_path) {
+    if (job_count >= job_cap) {
+        job_cap = job_cap ? job_cap * 2 : 64;
+        jobs = realloc(jobs, job_cap * sizeof *jobs);
+        if (!jobs) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    jobs[job_count].inode = *inode;
+    jobs[job_count].host_path = strdup(host_path);
+    job_count++;
+}
+
+// clear_jobs: free job and directory lists
+static void clear_jobs(void) {
+    for (int i = 0; i < job_count; i++) free(jobs[i].host_path);
+    for (int i = 0; i < dir_count; i++) free(dirs[i].host_path);
+    free(jobs);
+    free(dirs);
+    jobs = NULL;
+    dirs = NULL;
+    job_count = job_cap = 0;
+    dir_count = dir_cap = 0;
+    fail_count = 0;
+}
+
+// walk: create directories and symlinks, queue regular files
+static int walk(ext2_inode *inode, const char *host_path) {
+    if (S_ISREG(inode->i_mode)) {
+        add_job(inode, host_path);
+        return 0;
+    }
+    if (S_ISLNK(inode->i_mode))
+        return extract_symlink(inode, host_path);
+    if (!is_dir(inode))
+        return 0;   // devices, fifos and sockets are not extracted
+
+    // Keep the directory writable until all children are in place
+    if (mkdir(host_path, 0700) < 0 && errno != EEXIST) {
+        fprintf(ERR, "extract: %s: %s\n", host_path, strerror(errno));
+        return -1;
+    }
+    if (dir_count >= dir_cap) {
+        dir_cap = dir_cap ? dir_cap * 2 : 16;
+        dirs = realloc(dirs, dir_cap * sizeof *dirs);
+        if (!dirs) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    dirs[dir_count].inode = *inode;
+    dirs[dir_count].host_path = strdup(host_path);
+    dir_count++;
+
+    dir_child_list list;
+    dir_children(inode, &list);
+    for (int i = 0; i < list.count; i++) {
+        ext2_inode child;
+        char sub[MAX_PATH];
+        if (read_inode(list.v[i].ino, &child) < 0) continue;
+        snprintf(sub, sizeof(sub), "%s/%s", host_path, list.v[i].name);
+        walk(&child, sub);
+    }
+    free(list.v);
+    return 0;
+}
+
+// extract_symlink: recreate a fast (in-inode) or block-based symlink
+static int extract_symlink(ext2_inode *inode, const char *host_path) {
+    char target[MAX_PATH] = {0};
+    uint32_t len = inode->i_size < MAX_PATH - 1 ? inode->i_size : MAX_PATH - 1;
+
+    if (inode->i_blocks == 0) {
+        memcpy(target, inode->i_block, len < sizeof(inode->i_block) ? len : sizeof(inode->i_block));
+    } else {
+        char *buf = malloc(block_size);
+        if (!buf || read_blocks(inode->i_block[0], 1, buf) < 0) { free(buf); return -1; }
+        memcpy(target, buf, len < (uint32_t)block_size ? len : (uint32_t)block_size);
+        free(buf);
+    }
+    unlink(host_path);
+    if (symlink(target, host_path) < 0) {
+        fprintf(ERR, "extract: %s: %s\n", host_path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// copy_data: copy the mapped runs of a file, leaving holes unwritten
+static int copy_data(ext2_inode *inode, int out_fd, char *buf) {
+    block_iter it;
+    uint64_t lblk, size = inode_size64(inode);
+    uint32_t pblk, len;
+    int ret = 0;
+
+    biter_init(&it, inode);
+    while (biter_next(&it, &lblk, &pblk, &len, EXTRACT_CHUNK / block_size) > 0) {
+        if (!pblk) continue;    // hole: the final ftruncate leaves it sparse
+        off_t out_off = (off_t)lblk * block_size;
+        size_t bytes = (size_t)len * block_size;
+        if ((uint64_t)out_off + bytes > size) bytes = size - out_off;
+
+        // Let the kernel move the data when both files support it
+        // (not with O_DIRECT: the kernel would copy through the page cache)
+        if (__atomic_load_n(&use_copy_range, __ATOMIC_RELAXED) && !direct_align) {
+            loff_t in = (loff_t)pblk * block_size, out = out_off;
+            size_t left = bytes;
+            while (left > 0) {
+                ssize_t n = copy_file_range(fs_fd, &in, out_fd, &out, left, 0);
+                STAT_ADD(syscalls, 1);
+                if (n == 0) errno = EINVAL;
+                if (n <= 0) break;
+                STAT_ADD(bytes_read, n);
+                left -= n;
+            }
+            if (left == 0) {
+                STAT_ADD(blocks_read, len);
+                TRACE(pblk, len, TRACE_DATA);
+                continue;
+            }
+            if (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP) {
+                ret = -1;
+                break;
+            }
+            __atomic_store_n(&use_copy_range, 0, __ATOMIC_RELAXED);
+        }
+        if (read_blocks(pblk, len, buf) < 0) { ret = -1; break; }
+        size_t done = 0;
+        while (done < bytes) {
+            ssize_t n = pwrite(out_fd, buf + done, bytes - done, out_off + done);
+            if (n < 0) { ret = -1; break; }
+            done += n;
+        }
+        if (ret < 0) break;
+    }
+    biter_free(&it);
+    if (ret == 0 && ftruncate(out_fd, (off_t)size) < 0) ret = -1;
+    return ret;
+}
+
+// set_times: restore atime and mtime from the inode
+static void set_times(int fd, const char *host_path, ext2_inode *inode) {
+    struct timespec ts[2] = {
+        { inode->i_atime, 0 },
+        { inode->i_mtime, 0 },
+    };
+    if (fd >= 0) futimens(fd, ts);
+    else utimensat(AT_FDCWD, host_path, ts, 0);
+}
+
+// copy_file: create one host file and fill it from the image
+static int copy_file(ext2_inode *inode, const char *host_path, char *buf) {
+    int fd = open(host_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return -1;
+    int ret = copy_data(inode, fd, buf);
+    if (ret == 0) {
+        fchmod(fd, inode->i_mode & 07777);
+        set_times(fd, host_path, inode);
+    }
+    close(fd);
+    return ret;
+}
+
+// copy_job: run_jobs callback copying one queued file; 'arg' is the
+// caller's ERR, since OUT/ERR are per thread
+static void copy_job(int idx, char *buf, void *arg) {
+    FILE *err_out = arg;
+    ExtractJob *job = &jobs[idx];
+    if (copy_file(&job->inode, job->host_path, buf) < 0) {
+        int err = errno;
+        pthread_mutex_lock(&job_lock);
+        fail_count++;
+        fprintf(err_out, "extract: %s: %s\n", job->host_path, strerror(err));
+        pthread_mutex_unlock(&job_lock);
+    }
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : extract <PATH> <HOST_DIR>\n");
+}
+
+// cmd_extract: entry point for extract command
+void cmd_extract(int argc, char *argv[]) {
+    if (argc != 3) { help(); return; }
+    const char *path = argv[1];
+    const char *host_dir = argv[2];
+
+    // validate path
+    ext2_inode inode;
+    int ino = get_inode_by_path(path, &inode);
+    if (ino < 0) { help(); return; }
+
+    struct stat st;
+    if (mkdir(host_dir, 0755) < 0 && errno != EEXIST) {
+        fprintf(ERR, "Error: '%s': %s\n", host_dir, strerror(errno));
+        return;
+    }
+    if (stat(host_dir, &st) < 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(ERR, "Error: '%s' is not directory\n", host_dir);
+        return;
+    }
+
+    // The image root lands directly in HOST_DIR, anything else under its name
+    char target[MAX_PATH], base[EXT2_NAME_LEN+1];
+    path_name(path, base, sizeof(base));
+    if (ino == 2 || *base == '\0')
+        snprintf(target, sizeof(target), "%s", host_dir);
+    else
+        snprintf(target, sizeof(target), "%s/%s", host_dir, base);
+
+    clear_jobs();
+    walk(&inode, target);
+
+    // Copy regular files in parallel
+    run_jobs(job_count, EXTRACT_THREADS, EXTRACT_CHUNK, copy_job, ERR);
+
+    // Apply directory modes and times deepest-first so children stay writable
+    for (int i = dir_count - 1; i >= 0; i--) {
+        chmod(dirs[i].host_path, dirs[i].inode.i_mode & 07777);
+        set_times(-1, dirs[i].host_path, &dirs[i].inode);
+    }
+
+    fprintf(OUT, "%d directories, %d files extracted", dir_count, job_count - fail_count);
+    if (fail_count) fprintf(OUT, " (%d failed)", fail_count);
+    fprintf(OUT, "\n\n");
+    clear_jobs();
+}
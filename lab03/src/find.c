@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <fnmatch.h>
+#include "header.h"
+
+/* -- Prototypes -- */
+static int type_of(uint16_t mode);
+static void match_entry(const ext2_inode *inode, const char *path, void *arg);
+static void help(void);
+
+/* -- Match criteria -- */
+typedef struct {
+    const char *name;     // shell pattern for the last component, or NULL
+    int type;             // 'f', 'd', 'l' or 0 for any
+} FindTest;
+
+// type_of: find -type letter for an inode mode
+static int type_of(uint16_t mode) {
+    if (S_ISDIR(mode)) return 'd';
+    if (S_ISLNK(mode)) return 'l';
+    if (S_ISREG(mode)) return 'f';
+    return '?';
+}
+
+// match_entry: walk_tree callback printing paths that pass every test
+static void match_entry(const ext2_inode *inode, const char *path, void *arg) {
+    const FindTest *t = arg;
+    if (t->type && type_of(inode->i_mode) != t->type) return;
+    if (t->name) {
+        const char *base = strrchr(path, '/');
+        base = (base && base[1]) ? base + 1 : path;
+        if (fnmatch(t->name, base, 0) != 0) return;
+    }
+    fprintf(OUT, "%s\n", path);
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : find <PATH> [-name PATTERN] [-type f|d|l]\n");
+}
+
+// cmd_find: entry point for find command
+void cmd_find(int argc, char *argv[]) {
+    FindTest t = { NULL, 0 };
+
+    if (argc < 2) { help(); return; }
+    const char *path = argv[1];
+    // parse options
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-name") == 0 || strcmp(argv[i], "-type") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(ERR, "find: missing argument to '%s'\n", argv[i]);
+                return;
+            }
+            if (argv[i][1] == 'n') {
+                t.name = argv[++i];
+            } else {
+                const char *ty = argv[++i];
+                if (strlen(ty) != 1 || !strchr("fdl", ty[0])) { help(); return; }
+                t.type = ty[0];
+            }
+        } else {
+            help();
+            return;
+        }
+    }
+
+    // validate path
+    ext2_inode inode;
+    if (get_inode_by_path(path, &inode) < 0) { help(); return; }
+
+    walk_tree(&inode, path, match_entry, &t);
+    fflush(OUT);
+}
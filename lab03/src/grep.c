@@ -0,0 +1,235 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include "header.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define GREP_CHUNK    (1 << 20)   // bytes per coalesced read
+#define GREP_MAX_LINE (1 << 20)   // longer lines are split
+#define GREP_THREADS  8           // upper bound on search workers
+
+typedef struct GrepJob GrepJob;
+
+/* -- Prototypes -- */
+static const char *find_substr(const char *hay, size_t n, const char *pat, size_t m);
+static void add_file(const ext2_inode *inode, const char *path, void *arg);
+static void out_append(char **out, size_t *len, size_t *cap, const char *s, size_t n);
+static size_t scan_lines(GrepJob *job, const char *buf, size_t n, int at_eof);
+static int grep_inode(GrepJob *job, char *buf);
+static void grep_job(int idx, char *buf, void *arg);
+static void clear_jobs(void);
+static void help(void);
+
+/* -- Search job -- */
+struct GrepJob {
+    ext2_inode inode;
+    char *path;
+    char *out;            // formatted matches, printed in walk order
+    size_t out_len, out_cap;
+    uint64_t lineno;      // line number of the first byte of the pending data
+    int binary;           // NUL seen: report one line instead of matches
+    int matched;
+    int failed;
+};
+
+static GrepJob *jobs = NULL;
+static int job_count = 0, job_cap = 0;
+static const char *pattern;
+static size_t pattern_len;
+static int show_lineno = 0, show_path = 0;
+
+// find_substr: first/last-byte SIMD filter, then memcmp on candidates
+static const char *find_substr(const char *hay, size_t n, const char *pat, size_t m) {
+    if (m == 0) return hay;
+    if (n < m) return NULL;
+    if (m == 1) return memchr(hay, pat[0], n);
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(pat[0]);
+    const __m128i last  = _mm_set1_epi8(pat[m - 1]);
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(hay + i + m - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, pat + 1, m - 2) == 0) return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    // tail (or whole buffer without SSE2)
+    return memmem(hay + i, n - i, pat, m);
+}
+
+// add_file: walk_tree callback queueing every regular file in walk order
+static void add_file(const ext2_inode *inode, const char *path, void *arg) {
+    (void)arg;
+    if (!S_ISREG(inode->i_mode)) return;
+    if (job_count >= job_cap) {
+        job_cap = job_cap ? job_cap * 2 : 64;
+        jobs = realloc(jobs, job_cap * sizeof *jobs);
+        if (!jobs) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    memset(&jobs[job_count], 0, sizeof(jobs[job_count]));
+    jobs[job_count].inode = *inode;
+    jobs[job_count].path = strdup(path);
+    jobs[job_count].lineno = 1;
+    job_count++;
+}
+
+// clear_jobs: free job list and buffered output
+static void clear_jobs(void) {
+    for (int i = 0; i < job_count; i++) {
+        free(jobs[i].path);
+        free(jobs[i].out);
+    }
+    free(jobs);
+    jobs = NULL;
+    job_count = job_cap = 0;
+}
+
+static void out_append(char **out, size_t *len, size_t *cap, const char *s, size_t n) {
+    if (*len + n + 1 > *cap) {
+        *cap = (*len + n + 1) * 2;
+        *out = realloc(*out, *cap);
+        if (!*out) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    memcpy(*out + *len, s, n);
+    *len += n;
+    (*out)[*len] = '\0';
+}
+
+// scan_lines: report matching complete lines of buf; returns bytes consumed.
+// The unconsumed tail is a partial line and is searched again with the next block,
+// so matches that straddle a block boundary are found.
+static size_t scan_lines(GrepJob *job, const char *buf, size_t n, int at_eof) {
+    const char *end = buf + n;
+    const char *last_nl = n ? memrchr(buf, '\n', n) : NULL;
+    const char *limit = at_eof ? end : (last_nl ? last_nl + 1 : buf);
+    // a partial line may not outgrow the carry space
+    if (end - limit >= GREP_MAX_LINE) limit = end;
+
+    const char *p = buf;
+    while (p < limit) {
+        const char *hit = find_substr(p, limit - p, pattern, pattern_len);
+        if (!hit) break;
+        const char *ls = hit;
+        while (ls > p && ls[-1] != '\n') ls--;
+        const char *le = memchr(hit, '\n', limit - hit);
+        le = le ? le : limit;
+
+        job->matched = 1;
+        if (job->binary) { p = limit; break; }
+        if (show_lineno) {
+            for (const char *q = p; (q = memchr(q, '\n', ls - q)) != NULL; q++) job->lineno++;
+        }
+        char prefix[MAX_PATH + 32];
+        int plen = 0;
+        if (show_path) plen += snprintf(prefix + plen, sizeof(prefix) - plen, "%s:", job->path);
+        if (show_lineno) plen += snprintf(prefix + plen, sizeof(prefix) - plen, "%llu:",
+                                          (unsigned long long)job->lineno);
+        out_append(&job->out, &job->out_len, &job->out_cap, prefix, plen);
+        out_append(&job->out, &job->out_len, &job->out_cap, ls, le - ls);
+        out_append(&job->out, &job->out_len, &job->out_cap, "\n", 1);
+        p = le < limit ? le + 1 : limit;
+        if (show_lineno && le < limit) job->lineno++;
+    }
+    if (show_lineno) {
+        for (const char *q = p; q < limit && (q = memchr(q, '\n', limit - q)) != NULL; q++)
+            job->lineno++;
+    }
+    return limit - buf;
+}
+
+// grep_inode: search a file block run by block run
+static int grep_inode(GrepJob *job, char *buf) {
+    block_iter it;
+    uint64_t lblk, remaining = inode_size64(&job->inode);
+    uint32_t pblk, len;
+    size_t carry = 0;
+    int ret = 0;
+
+    biter_init(&it, &job->inode);
+    while (remaining > 0 && biter_next(&it, &lblk, &pblk, &len, GREP_CHUNK / block_size) > 0) {
+        size_t run = (size_t)len * block_size;
+        size_t bytes = remaining < run ? (size_t)remaining : run;
+        char *dst = buf + carry;
+        // holes read back as zeros
+        if (!pblk) memset(dst, 0, bytes);
+        else if (read_blocks(pblk, len, dst) < 0) { ret = -1; break; }
+        if (!job->binary && memchr(dst, '\0', bytes)) job->binary = 1;
+        remaining -= bytes;
+
+        size_t used = scan_lines(job, buf, carry + bytes, remaining == 0);
+        if (job->binary && job->matched) break;
+        carry = carry + bytes - used;
+        memmove(buf, buf + used, carry);
+    }
+    biter_free(&it);
+    if (job->binary && job->matched) {
+        job->out_len = 0;
+        char line[MAX_PATH + 32];
+        int n = snprintf(line, sizeof(line), "Binary file %s matches\n", job->path);
+        out_append(&job->out, &job->out_len, &job->out_cap, line, n);
+    }
+    return ret;
+}
+
+// grep_job: run_jobs callback searching one queued file
+static void grep_job(int idx, char *buf, void *arg) {
+    (void)arg;
+    jobs[idx].failed = grep_inode(&jobs[idx], buf) < 0;
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : grep <PATTERN> <PATH> [-r] [-n]\n");
+}
+
+// cmd_grep: entry point for grep command
+void cmd_grep(int argc, char *argv[]) {
+    int recursive = 0;
+
+    if (argc < 3) { help(); return; }
+    const char *path = argv[2];
+    show_lineno = 0;
+    // parse options
+    for (int i = 3; i < argc; i++) {
+        if (argv[i][0] != '-' || argv[i][1] == '\0') { help(); return; }
+        for (char *p = &argv[i][1]; *p; p++) {
+            if (*p == 'r') recursive = 1;
+            else if (*p == 'n') show_lineno = 1;
+            else { help(); return; }
+        }
+    }
+
+    // validate path
+    ext2_inode inode;
+    if (get_inode_by_path(path, &inode) < 0) { help(); return; }
+    if (is_dir(&inode) && !recursive) {
+        fprintf(ERR, "Error: '%s' is not file\n", path);
+        return;
+    }
+
+    clear_jobs();
+    pattern = argv[1];
+    pattern_len = strlen(pattern);
+    show_path = is_dir(&inode);
+    walk_tree(&inode, path, add_file, NULL);
+
+    // Search files in parallel, print in walk order
+    // room for one run plus a carried partial line
+    run_jobs(job_count, GREP_THREADS, GREP_CHUNK + GREP_MAX_LINE, grep_job, NULL);
+
+    for (int i = 0; i < job_count; i++) {
+        if (jobs[i].failed) fprintf(ERR, "grep: %s: read error\n", jobs[i].path);
+        if (jobs[i].out_len) fwrite(jobs[i].out, 1, jobs[i].out_len, OUT);
+    }
+    fflush(OUT);
+    clear_jobs();
+}
@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "header.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+/* -- Prototypes -- */
+static void crc32c_setup(void);
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *p, size_t len);
+static uint32_t crc32c_update(uint32_t crc, const uint8_t *p, size_t len);
+static void xxh64_update(hash_ctx *ctx, const uint8_t *p, size_t len);
+static uint64_t xxh64_final(hash_ctx *ctx);
+static void sha256_block(uint32_t st[8], const uint8_t *p);
+static void sha256_update(hash_ctx *ctx, const uint8_t *p, size_t len);
+static void sha256_final(hash_ctx *ctx, uint8_t out[32]);
+
+/* ---------------- CRC32C (Castagnoli) ---------------- */
+
+static uint32_t crc32c_table[8][256];
+static int crc32c_hw = 0;    // 1 when SSE4.2 crc32 is available
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+// crc32c_setup: detect SSE4.2 and build slicing-by-8 tables for the software path
+static void crc32c_setup(void) {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    crc32c_hw = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+#endif
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0x82F63B78 & (0 - (c & 1)));
+        crc32c_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++)
+        for (int t = 1; t < 8; t++)
+            crc32c_table[t][i] = (crc32c_table[t - 1][i] >> 8) ^ crc32c_table[0][crc32c_table[t - 1][i] & 0xff];
+}
+
+// crc32c_sw: slicing-by-8, eight bytes per step
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        v ^= crc;
+        crc = crc32c_table[7][v & 0xff] ^ crc32c_table[6][(v >> 8) & 0xff]
+            ^ crc32c_table[5][(v >> 16) & 0xff] ^ crc32c_table[4][(v >> 24) & 0xff]
+            ^ crc32c_table[3][(v >> 32) & 0xff] ^ crc32c_table[2][(v >> 40) & 0xff]
+            ^ crc32c_table[1][(v >> 48) & 0xff] ^ crc32c_table[0][v >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xff];
+    return crc;
+}
+
+#if defined(__x86_64__)
+// crc32c_hw_update: SSE4.2 crc32 instruction, eight bytes per step
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw_update(uint32_t crc, const uint8_t *p, size_t len) {
+    uint64_t c = crc;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        len -= 8;
+    }
+    uint32_t c32 = (uint32_t)c;
+    while (len--) c32 = _mm_crc32_u8(c32, *p++);
+    return c32;
+}
+#endif
+
+// crc32c_update: hardware path when the CPU has it, tables otherwise
+static uint32_t crc32c_update(uint32_t crc, const uint8_t *p, size_t len) {
+#if defined(__x86_64__)
+    if (crc32c_hw) return crc32c_hw_update(crc, p, len);
+#endif
+    return crc32c_sw(crc, p, len);
+}
+
+/* ---------------- XXH64 ---------------- */
+
+#define XXH_P1 0x9E3779B185EBCA87ULL
+#define XXH_P2 0xC2B2AE3D27D4EB4FULL
+#define XXH_P3 0x165667B19E3779F9ULL
+#define XXH_P4 0x85EBCA77C2B2AE63ULL
+#define XXH_P5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t in) {
+    acc += in * XXH_P2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_P1;
+}
+
+static inline uint64_t xxh_merge(uint64_t acc, uint64_t v) {
+    acc ^= xxh_round(0, v);
+    return acc * XXH_P1 + XXH_P4;
+}
+
+static inline uint64_t rd64(const uint8_t *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint32_t rd32(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+// xxh64_update: four independent lanes over 32-byte stripes
+static void xxh64_update(hash_ctx *ctx, const uint8_t *p, size_t len) {
+    ctx->u.xxh.total += len;
+    if (ctx->u.xxh.memsize + len < 32) {
+        memcpy(ctx->u.xxh.mem + ctx->u.xxh.memsize, p, len);
+        ctx->u.xxh.memsize += len;
+        return;
+    }
+    uint64_t *v = ctx->u.xxh.v;
+    if (ctx->u.xxh.memsize) {
+        size_t fill = 32 - ctx->u.xxh.memsize;
+        memcpy(ctx->u.xxh.mem + ctx->u.xxh.memsize, p, fill);
+        for (int i = 0; i < 4; i++) v[i] = xxh_round(v[i], rd64(ctx->u.xxh.mem + i * 8));
+        p += fill;
+        len -= fill;
+        ctx->u.xxh.memsize = 0;
+    }
+    uint64_t v1 = v[0], v2 = v[1], v3 = v[2], v4 = v[3];
+    while (len >= 32) {
+        v1 = xxh_round(v1, rd64(p));
+        v2 = xxh_round(v2, rd64(p + 8));
+        v3 = xxh_round(v3, rd64(p + 16));
+        v4 = xxh_round(v4, rd64(p + 24));
+        p += 32;
+        len -= 32;
+    }
+    v[0] = v1; v[1] = v2; v[2] = v3; v[3] = v4;
+    memcpy(ctx->u.xxh.mem, p, len);
+    ctx->u.xxh.memsize = len;
+}
+
+static uint64_t xxh64_final(hash_ctx *ctx) {
+    uint64_t *v = ctx->u.xxh.v, h;
+    const uint8_t *p = ctx->u.xxh.mem;
+    size_t len = ctx->u.xxh.memsize;
+
+    if (ctx->u.xxh.total >= 32) {
+        h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+        for (int i = 0; i < 4; i++) h = xxh_merge(h, v[i]);
+    } else {
+        h = v[2] + XXH_P5;   // v[2] holds the seed (0)
+    }
+    h += ctx->u.xxh.total;
+    while (len >= 8) {
+        h ^= xxh_round(0, rd64(p));
+        h = rotl64(h, 27) * XXH_P1 + XXH_P4;
+        p += 8;
+        len -= 8;
+    }
+    if (len >= 4) {
+        h ^= (uint64_t)rd32(p) * XXH_P1;
+        h = rotl64(h, 23) * XXH_P2 + XXH_P3;
+        p += 4;
+        len -= 4;
+    }
+    while (len--) {
+        h ^= (*p++) * XXH_P5;
+        h = rotl64(h, 11) * XXH_P1;
+    }
+    h ^= h >> 33;
+    h *= XXH_P2;
+    h ^= h >> 29;
+    h *= XXH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* ---------------- SHA-256 ---------------- */
+
+static const uint32_t sha_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t rotr32(uint32_t x, int r) { return (x >> r) | (x << (32 - r)); }
+
+// sha256_block: compress one 64-byte block
+static void sha256_block(uint32_t st[8], const uint8_t *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)p[i*4] << 24 | (uint32_t)p[i*4+1] << 16 | (uint32_t)p[i*4+2] << 8 | p[i*4+3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr32(w[i-15], 7) ^ rotr32(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = rotr32(w[i-2], 17) ^ rotr32(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+    uint32_t a = st[0], b = st[1], c = st[2], d = st[3];
+    uint32_t e = st[4], f = st[5], g = st[6], h = st[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25))
+                    + ((e & f) ^ (~e & g)) + sha_k[i] + w[i];
+        uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22))
+                    + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    st[0] += a; st[1] += b; st[2] += c; st[3] += d;
+    st[4] += e; st[5] += f; st[6] += g; st[7] += h;
+}
+
+static void sha256_update(hash_ctx *ctx, const uint8_t *p, size_t len) {
+    ctx->u.sha.total += len;
+    if (ctx->u.sha.buflen) {
+        size_t fill = 64 - ctx->u.sha.buflen;
+        if (fill > len) fill = len;
+        memcpy(ctx->u.sha.buf + ctx->u.sha.buflen, p, fill);
+        ctx->u.sha.buflen += fill;
+        p += fill;
+        len -= fill;
+        if (ctx->u.sha.buflen < 64) return;
+        sha256_block(ctx->u.sha.st, ctx->u.sha.buf);
+        ctx->u.sha.buflen = 0;
+    }
+    while (len >= 64) {
+        sha256_block(ctx->u.sha.st, p);
+        p += 64;
+        len -= 64;
+    }
+    memcpy(ctx->u.sha.buf, p, len);
+    ctx->u.sha.buflen = len;
+}
+
+static void sha256_final(hash_ctx *ctx, uint8_t out[32]) {
+    uint64_t bits = ctx->u.sha.total * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t padlen = (ctx->u.sha.buflen < 56 ? 56 : 120) - ctx->u.sha.buflen;
+    for (int i = 0; i < 8; i++) pad[padlen + i] = (uint8_t)(bits >> (56 - 8 * i));
+    sha256_update(ctx, pad, padlen + 8);
+    for (int i = 0; i < 8; i++) {
+        out[i*4]   = ctx->u.sha.st[i] >> 24;
+        out[i*4+1] = ctx->u.sha.st[i] >> 16;
+        out[i*4+2] = ctx->u.sha.st[i] >> 8;
+        out[i*4+3] = ctx->u.sha.st[i];
+    }
+}
+
+/* ---------------- Common interface ---------------- */
+
+// hash_by_name: map "-a" argument to an algorithm id, -1 if unknown
+int hash_by_name(const char *name) {
+    if (strcmp(name, "crc32c") == 0) return HASH_CRC32C;
+    if (strcmp(name, "xxh64") == 0)  return HASH_XXH64;
+    if (strcmp(name, "sha256") == 0) return HASH_SHA256;
+    return -1;
+}
+
+void hash_init(hash_ctx *ctx, int alg) {
+    static const uint32_t sha_iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->alg = alg;
+    if (alg == HASH_CRC32C) {
+        pthread_once(&crc32c_once, crc32c_setup);
+        ctx->u.crc = 0xFFFFFFFF;
+    } else if (alg == HASH_XXH64) {
+        ctx->u.xxh.v[0] = XXH_P1 + XXH_P2;
+        ctx->u.xxh.v[1] = XXH_P2;
+        ctx->u.xxh.v[2] = 0;
+        ctx->u.xxh.v[3] = 0 - XXH_P1;
+    } else {
+        memcpy(ctx->u.sha.st, sha_iv, sizeof(sha_iv));
+    }
+}
+
+void hash_update(hash_ctx *ctx, const void *data, size_t len) {
+    if (ctx->alg == HASH_CRC32C)     ctx->u.crc = crc32c_update(ctx->u.crc, data, len);
+    else if (ctx->alg == HASH_XXH64) xxh64_update(ctx, data, len);
+    else                             sha256_update(ctx, data, len);
+}
+
+// hash_final: write the digest as lowercase hex into out (>= 65 bytes)
+void hash_final(hash_ctx *ctx, char *out) {
+    if (ctx->alg == HASH_CRC32C) {
+        sprintf(out, "%08x", ctx->u.crc ^ 0xFFFFFFFF);
+    } else if (ctx->alg == HASH_XXH64) {
+        sprintf(out, "%016llx", (unsigned long long)xxh64_final(ctx));
+    } else {
+        uint8_t d[32];
+        sha256_final(ctx, d);
+        for (int i = 0; i < 32; i++) sprintf(out + i * 2, "%02x", d[i]);
+    }
+}
@@ -1,3 +1,4 @@
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -49,12 +50,16 @@ typedef struct ext2_super_block {
     uint16_t s_inode_size;
 } ext2_super_block;
 
-// On-disk ext2 group descriptor (minimal)
+// On-disk ext2 group descriptor
 typedef struct ext2_group_desc {
     uint32_t bg_block_bitmap;
     uint32_t bg_inode_bitmap;
     uint32_t bg_inode_table;
-    // ... other fields omitted
+    uint16_t bg_free_blocks_count;
+    uint16_t bg_free_inodes_count;
+    uint16_t bg_used_dirs_count;
+    uint16_t bg_pad;
+    uint8_t  bg_reserved[12];
 } ext2_group_desc;
 
 // On-disk ext2 inode (simplified)
@@ -92,14 +97,191 @@ typedef struct ext2_dir_entry_2 {
 extern int fs_fd;                     // file descriptor of image
 extern ext2_super_block sb;           // superblock
 extern ext2_group_desc gd;            // group descriptor
+extern ext2_group_desc *gdt;          // group descriptor table (all groups)
+extern uint32_t group_count;          // number of block groups
 extern int block_size;
 extern int inode_size;
+extern int direct_align;              // O_DIRECT alignment in bytes, 0 for buffered reads
+
+// Saved state of one open image, so a command can switch between two (diff.c)
+typedef struct ext2_image {
+    int fd;
+    ext2_super_block sb;
+    ext2_group_desc *gdt;
+    uint32_t group_count;
+    int block_size;
+    int inode_size;
+    int direct_align;
+    void *cache_slots;                // block cache of this image (ext2.c)
+    char *cache_data;
+    uint32_t cache_clock;
+} ext2_image;
+
+// One read of a batch (see read_batch)
+typedef struct read_req {
+    off_t  off;                       // image offset
+    size_t len;                       // bytes to read
+    void  *buf;                       // destination
+} read_req;
+
+// Entries of one directory (see dir_children)
+typedef struct dir_child {
+    uint32_t ino;
+    char     name[EXT2_NAME_LEN+1];
+} dir_child;
+typedef struct dir_child_list {
+    dir_child *v;
+    int count, cap;
+} dir_child_list;
+
+// Image I/O counters (stats.c)
+typedef struct io_counters {
+    uint64_t blocks_read;             // blocks fetched from the image
+    uint64_t bytes_read;              // bytes returned by read syscalls
+    uint64_t syscalls;                // pread / io_uring_enter / copy_file_range calls
+    uint64_t cache_hits;              // block cache hits
+    uint64_t cache_misses;            // block cache misses
+    uint64_t inode_reads;             // inodes requested
+    uint64_t dir_blocks;              // directory blocks parsed
+    uint64_t tree_hits;               // tree subtrees replayed from the tree cache
+    uint64_t warm_blocks;             // blocks prefetched by the warm-up thread
+} io_counters;
+
+// Block access trace (trace.c): file = trace_header, command names, records
+#define TRACE_MAGIC    "E2TR"
+#define TRACE_VERSION  1
+#define TRACE_NAME_LEN 16
+enum { TRACE_DIR, TRACE_INODE, TRACE_INDIRECT, TRACE_DATA, TRACE_META, TRACE_KINDS };
+typedef struct trace_header {
+    char     magic[4];                // TRACE_MAGIC
+    uint16_t version;                 // TRACE_VERSION
+    uint16_t ncmds;                   // command names following the header
+    uint32_t block_size;              // image block size
+    uint32_t blocks_count;            // image size in blocks
+} trace_header;
+typedef struct trace_rec {
+    uint32_t blk;                     // first physical block
+    uint16_t count;                   // contiguous blocks in this access
+    uint8_t  kind;                    // TRACE_DIR .. TRACE_META
+    uint8_t  cmd;                     // index into the command names
+    uint64_t ns;                      // time since the trace started
+} trace_rec;
+
+// Streaming hash state (hash.c)
+enum { HASH_CRC32C, HASH_XXH64, HASH_SHA256 };
+typedef struct hash_ctx {
+    int alg;
+    union {
+        uint32_t crc;
+        struct { uint64_t v[4]; uint64_t total; uint8_t mem[32]; size_t memsize; } xxh;
+        struct { uint32_t st[8]; uint64_t total; uint8_t buf[64]; size_t buflen; } sha;
+    } u;
+} hash_ctx;
+
+// Block iterator: walks an inode's data blocks in logical order
+typedef struct block_iter {
+    ext2_inode inode;                 // inode being walked
+    uint64_t next;                    // next logical block
+    uint64_t nblocks;                 // logical blocks covering i_size
+    uint32_t ind_blk[3];              // cached indirect block number per depth
+    uint32_t *ind[3];                 // cached indirect block contents
+} block_iter;
+
+// Command output: commands print to OUT / ERR, which the query server
+// points at the client socket for the calling worker thread
+extern __thread FILE *cmd_out;
+extern __thread FILE *cmd_err;
+#define OUT (cmd_out ? cmd_out : stdout)
+#define ERR (cmd_err ? cmd_err : stderr)
 
 // Initialization and main loop
-int init_ext2_structures(const char *disk_image);
+int init_ext2_structures(const char *disk_image, int direct);
 void cmd_loop(void);
+int run_command(int argc, char *argv[]);
+
+// Image access (ext2.c)
+ssize_t image_pread(void *buf, size_t len, off_t off);
+int read_block(uint32_t blk, void *buf);
+int read_blocks(uint32_t blk, uint32_t count, void *buf);
+int read_blocks_as(uint32_t blk, uint32_t count, void *buf, int kind);
+int read_inode(uint32_t ino, ext2_inode *buf);
+int read_batch(read_req *reqs, int n);
+int read_inodes(const uint32_t *inos, int n, ext2_inode *out);
+int get_inode_by_path(const char *path, ext2_inode *inode);
+void path_name(const char *path, char *name, size_t cap);
+void image_save(ext2_image *img);
+void image_use(const ext2_image *img);
+void image_close(ext2_image *img);
+int dir_iterate(const ext2_inode *dir,
+                int (*fn)(const ext2_dir_entry_2 *e, void *arg), void *arg);
+int dir_children(const ext2_inode *dir, dir_child_list *list);
+void walk_tree(const ext2_inode *inode, const char *path,
+               void (*fn)(const ext2_inode *inode, const char *path, void *arg), void *arg);
+int is_dir(const ext2_inode *inode);
+uint64_t inode_size64(const ext2_inode *inode);
+int biter_init(block_iter *it, const ext2_inode *inode);
+int biter_next(block_iter *it, uint64_t *lblk, uint32_t *pblk, uint32_t *len, uint32_t max);
+void biter_free(block_iter *it);
+void select_block_ops(void);
+int cache_fill(uint32_t blk, const void *src);
+uint32_t cache_capacity(void);
+
+// io_uring backend (uring.c)
+extern int use_uring;
+int uring_init(unsigned entries);
+int uring_read_batch(read_req *reqs, int n);
+void uring_exit(void);
+
+// Parallel jobs (jobs.c)
+void run_jobs(int count, int max_threads, size_t buf_len,
+              void (*fn)(int idx, char *buf, void *arg), void *arg);
+
+// Image comparison (diff.c)
+int diff_images(int argc, char *argv[]);
+
+// Background cache warm-up (warm.c)
+int warm_start(void);
+void warm_stop(void);
+void warm_hold(void);
+void warm_release(void);
+
+// Query server (serve.c)
+int serve(const char *sock_path);
+
+// Block access tracing (trace.c)
+extern int tracing;
+#define TRACE(blk, count, kind) do { if (tracing) trace_access((blk), (count), (kind)); } while (0)
+int trace_open(const char *path);
+void trace_command(const char *name, int this_thread);
+void trace_access(uint32_t blk, uint32_t count, int kind);
+void trace_close(void);
+
+// Hashing (hash.c)
+int hash_by_name(const char *name);
+void hash_init(hash_ctx *ctx, int alg);
+void hash_update(hash_ctx *ctx, const void *data, size_t len);
+void hash_final(hash_ctx *ctx, char *out);
+
+// Statistics (stats.c)
+extern io_counters io_stats;
+#define STAT_ADD(field, n) __atomic_fetch_add(&io_stats.field, (uint64_t)(n), __ATOMIC_RELAXED)
+void stats_record_command(const char *name, double seconds);
+
+// Latency histograms (timing.c)
+void timing_record(const char *name, double seconds);
 
 // Command functions
 void cmd_tree(int argc, char *argv[]);
 void cmd_print(int argc, char *argv[]);
+void cmd_extract(int argc, char *argv[]);
+void cmd_stats(int argc, char *argv[]);
+int cmd_time(int argc, char *argv[]);
+void cmd_sum(int argc, char *argv[]);
+void cmd_grep(int argc, char *argv[]);
+void cmd_find(int argc, char *argv[]);
+void cmd_stat(int argc, char *argv[]);
+void cmd_check(int argc, char *argv[]);
+void cmd_export(int argc, char *argv[]);
+void cmd_owner(int argc, char *argv[]);
+void cmd_dump_meta(int argc, char *argv[]);
 void cmd_help(char *arg);
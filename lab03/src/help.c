@@ -5,6 +5,17 @@
 void all_help();
 void tree_help();
 void print_help();
+void extract_help();
+void sum_help();
+void grep_help();
+void find_help();
+void stat_help();
+void check_help();
+void export_help();
+void owner_help();
+void dump_meta_help();
+void stats_help();
+void time_help();
 void help_help();
 void exit_help();
 
@@ -20,6 +31,39 @@ void cmd_help(char *arg)
     }else if(strcmp(arg, "print") == 0){
         print_help();
         printf("\n");
+    }else if(strcmp(arg, "extract") == 0){
+        extract_help();
+        printf("\n");
+    }else if(strcmp(arg, "sum") == 0){
+        sum_help();
+        printf("\n");
+    }else if(strcmp(arg, "grep") == 0){
+        grep_help();
+        printf("\n");
+    }else if(strcmp(arg, "find") == 0){
+        find_help();
+        printf("\n");
+    }else if(strcmp(arg, "stat") == 0){
+        stat_help();
+        printf("\n");
+    }else if(strcmp(arg, "check") == 0){
+        check_help();
+        printf("\n");
+    }else if(strcmp(arg, "export") == 0){
+        export_help();
+        printf("\n");
+    }else if(strcmp(arg, "owner") == 0){
+        owner_help();
+        printf("\n");
+    }else if(strcmp(arg, "dump-meta") == 0){
+        dump_meta_help();
+        printf("\n");
+    }else if(strcmp(arg, "stats") == 0){
+        stats_help();
+        printf("\n");
+    }else if(strcmp(arg, "time") == 0){
+        time_help();
+        printf("\n");
     }else if(strcmp(arg, "help") == 0){
         help_help();
         printf("\n");
@@ -38,6 +82,17 @@ void cmd_help(char *arg)
 void all_help(){
     tree_help();
     print_help();
+    extract_help();
+    sum_help();
+    grep_help();
+    find_help();
+    stat_help();
+    check_help();
+    export_help();
+    owner_help();
+    dump_meta_help();
+    stats_help();
+    time_help();
     help_help();
     exit_help();
 }
@@ -52,8 +107,72 @@ void tree_help(){
 
 // print_help: Usage instructions for the 'print' command.
 void print_help(){
-    printf("  > print <PATH> [OPTION]... : print the contents on the standard output if <PATH> is file\n");
-    printf("    -n <line_number> : print only the first <line_number> lines of its contents on the standard output if <PATH> is file\n");
+    printf("  > print <PATH>... [OPTION]... : print the contents of each file <PATH> (shell patterns allowed) on the standard output in order\n");
+    printf("    -n <line_number> : print only the first <line_number> lines of each file on the standard output\n");
+}
+
+// extract_help: Usage instructions for the 'extract' command.
+void extract_help(){
+    printf("  > extract <PATH> <HOST_DIR> : copy the file or directory subtree <PATH> into <HOST_DIR> on the host\n");
+}
+
+// sum_help: Usage instructions for the 'sum' command.
+void sum_help(){
+    printf("  > sum <PATH> [OPTION]... : print the checksum of the file <PATH>\n");
+    printf("    -a <crc32c|xxh64|sha256> : select the hash algorithm (default crc32c)\n");
+    printf("    -r : checksum every file under <PATH> if <PATH> is a directory\n");
+}
+
+// grep_help: Usage instructions for the 'grep' command.
+void grep_help(){
+    printf("  > grep <PATTERN> <PATH> [OPTION]... : print lines of the file <PATH> containing <PATTERN>\n");
+    printf("    -r : search every file under <PATH> if <PATH> is a directory\n");
+    printf("    -n : prefix each matching line with its line number\n");
+}
+
+// find_help: Usage instructions for the 'find' command.
+void find_help(){
+    printf("  > find <PATH> [OPTION]... : print every path under <PATH> that matches all given tests\n");
+    printf("    -name <PATTERN> : the last path component matches the shell pattern <PATTERN>\n");
+    printf("    -type <f|d|l> : the entry is a regular file, directory or symbolic link\n");
+}
+
+// stat_help: Usage instructions for the 'stat' command.
+void stat_help(){
+    printf("  > stat <PATH> : display inode number, type, size, links, owner, permissions and times of <PATH>\n");
+}
+
+// check_help: Usage instructions for the 'check' command.
+void check_help(){
+    printf("  > check : verify block pointers, bitmaps, directory entries and link counts of the image (read-only)\n");
+}
+
+// export_help: Usage instructions for the 'export' command.
+void export_help(){
+    printf("  > export <PATH> -o <FILE|-> : write the file or directory subtree <PATH> as a POSIX tar stream to <FILE> or the standard output\n");
+}
+
+// owner_help: Usage instructions for the 'owner' command.
+void owner_help(){
+    printf("  > owner <BLOCK|FIRST-LAST>... [OPTION]... : print the file (path, inode and block within the file) or metadata each physical block belongs to\n");
+    printf("    -f <HOST_FILE> : also look up every block number or FIRST-LAST range listed in <HOST_FILE> on the host\n");
+}
+
+// dump_meta_help: Usage instructions for the 'dump-meta' command.
+void dump_meta_help(){
+    printf("  > dump-meta <HOST_FILE> : write a sparse copy of the image holding only superblocks, group descriptors, bitmaps, inode tables, directory and indirect blocks to <HOST_FILE>\n");
+}
+
+// stats_help: Usage instructions for the 'stats' command.
+void stats_help(){
+    printf("  > stats [reset] : show image I/O, block cache and per-command time counters\n");
+    printf("    reset : clear all counters\n");
+}
+
+// time_help: Usage instructions for the 'time' prefix.
+void time_help(){
+    printf("  > time <COMMAND> [ARG]... : run <COMMAND> and report wall, user and system time and page faults\n");
+    printf("    summary : show per-command latency (min, p50, p99, max) for this session\n");
 }
 
 // help_help: Usage instructions for the 'help' command itself.
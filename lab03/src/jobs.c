@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <pthread.h>
+#include "header.h"
+
+#define JOBS_MAX_THREADS 64
+
+/* -- One run of run_jobs() -- */
+typedef struct {
+    void (*fn)(int idx, char *buf, void *arg);
+    void *arg;
+    int count;
+    int next;                 // next index to hand out (atomic)
+    size_t buf_len;
+} JobRun;
+
+/* -- Prototypes -- */
+static void *job_worker(void *arg);
+
+// job_worker: run jobs in index order until none is left
+static void *job_worker(void *arg) {
+    JobRun *run = arg;
+    char *buf = NULL;
+    if (run->buf_len && !(buf = malloc(run->buf_len))) return NULL;
+    int idx;
+    while ((idx = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED)) < run->count)
+        run->fn(idx, buf, run->arg);
+    free(buf);
+    return NULL;
+}
+
+// run_jobs: call fn for every index below 'count' on up to max_threads threads
+// (never more than the CPUs online); each thread gets its own buf_len scratch
+// buffer. Whatever the threads leave undone runs on the calling thread.
+void run_jobs(int count, int max_threads, size_t buf_len,
+              void (*fn)(int idx, char *buf, void *arg), void *arg) {
+    JobRun run = { fn, arg, count, 0, buf_len };
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = ncpu > 0 ? (int)ncpu : 1;
+    if (nthreads > max_threads) nthreads = max_threads;
+    if (nthreads > JOBS_MAX_THREADS) nthreads = JOBS_MAX_THREADS;
+    if (nthreads > count) nthreads = count;
+
+    pthread_t tids[JOBS_MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < nthreads; i++)
+        if (pthread_create(&tids[started], NULL, job_worker, &run) == 0) started++;
+    for (int i = 0; i < started; i++)
+        pthread_join(tids[i], NULL);
+    // no thread could start, or one could not get its buffer
+    if (__atomic_load_n(&run.next, __ATOMIC_RELAXED) < count)
+        job_worker(&run);
+}
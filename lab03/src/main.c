@@ -1,33 +1,67 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
 #include "header.h"
 
 // Global variables defined in header.h
 int fs_fd;
 struct ext2_super_block sb;
 struct ext2_group_desc gd;
+struct ext2_group_desc *gdt;
+uint32_t group_count;
 int block_size;
 int inode_size;
+int direct_align;
 
-// init_ext2_structures: open image, read superblock and group descriptor
-int init_ext2_structures(const char *disk_image) {
+// probe_direct_align: sector alignment O_DIRECT reads need on this image, 0 if none works
+static int probe_direct_align(int fd) {
+    struct stat st;
+    int ssz;
+    if (fstat(fd, &st) == 0 && S_ISBLK(st.st_mode) && ioctl(fd, BLKSSZGET, &ssz) == 0)
+        return ssz;
+    // regular file: try the usual logical sector sizes
+    void *p;
+    int align = 0;
+    if (posix_memalign(&p, 4096, 4096) != 0) return 0;
+    for (int a = 512; a <= 4096 && !align; a *= 2)
+        if (pread(fd, p, a, a) == a) align = a;
+    free(p);
+    return align;
+}
+
+// init_ext2_structures: open image, read superblock and group descriptor.
+// With 'direct' the image is read with O_DIRECT so scans bypass the page cache;
+// metadata is still cached by the block cache in ext2.c
+int init_ext2_structures(const char *disk_image, int direct) {
     // Open disk image read-only
-    fs_fd = open(disk_image, O_RDONLY);
+    direct_align = 0;
+    fs_fd = open(disk_image, O_RDONLY | (direct ? O_DIRECT : 0));
+    if (fs_fd < 0 && direct && errno == EINVAL) {
+        fprintf(stderr, "O_DIRECT not supported for '%s', using buffered reads\n", disk_image);
+        direct = 0;
+        fs_fd = open(disk_image, O_RDONLY);
+    }
     if (fs_fd < 0) {
         perror("open");
         return -1;
     }
-   
-    // Read superblock at offset 1024
-    if (lseek(fs_fd, 1024, SEEK_SET) < 0) {
-        perror("lseek superblock");
+    if (direct && (direct_align = probe_direct_align(fs_fd)) == 0) {
+        fprintf(stderr, "cannot find O_DIRECT alignment for '%s', using buffered reads\n", disk_image);
         close(fs_fd);
-        return -1;
+        if ((fs_fd = open(disk_image, O_RDONLY)) < 0) {
+            perror("open");
+            return -1;
+        }
     }
-    if (read(fs_fd, &sb, sizeof(sb)) != sizeof(sb)) {
+
+    // Read superblock at offset 1024
+    if (image_pread(&sb, sizeof(sb), 1024) != sizeof(sb)) {
         perror("read superblock");
         close(fs_fd);
         return -1;
@@ -43,40 +77,88 @@ int init_ext2_structures(const char *disk_image) {
     // Compute block size and inode size
     block_size = 1024 << sb.s_log_block_size;
     inode_size = sb.s_inode_size;
+    select_block_ops();
 
-    // Read first group descriptor
-	off_t gd_offset = (sb.s_first_data_block + 1) * block_size;
-    if (lseek(fs_fd, gd_offset, SEEK_SET) < 0) {
-        perror("lseek group_desc");
+    // Read group descriptor table (follows the superblock block)
+    group_count = (sb.s_blocks_count - sb.s_first_data_block
+                   + sb.s_blocks_per_group - 1) / sb.s_blocks_per_group;
+    size_t gdt_len = (size_t)group_count * sizeof(*gdt);
+	off_t gd_offset = (off_t)(sb.s_first_data_block + 1) * block_size;
+    gdt = malloc(gdt_len);
+    if (!gdt) {
+        perror("malloc group_desc");
         close(fs_fd);
         return -1;
     }
-    if (read(fs_fd, &gd, sizeof(gd)) != sizeof(gd)) {
+    if (image_pread(gdt, gdt_len, gd_offset) != (ssize_t)gdt_len) {
         perror("read group_desc");
+        free(gdt);
         close(fs_fd);
         return -1;
     }
+    gd = gdt[0];
 	
     return 0;
 }
 
 // main: Program entry point
 int main(int argc, char *argv[]) {
+    // "ssu_ext2 diff <IMAGE_A> <IMAGE_B> [PATH]" compares two images and exits
+    if (argc >= 2 && strcmp(argv[1], "diff") == 0)
+        return diff_images(argc, argv);
+
     // Validate command-line usage
     if (argc < 2) {
-        fprintf(stderr, "Usage Error : %s <EXT2_IMAGE>\n", argv[0]);
+        fprintf(stderr, "Usage Error : %s <EXT2_IMAGE> [--uring] [--direct] [--warm] [--trace <FILE>] [--serve <SOCKET>]\n", argv[0]);
         return EXIT_FAILURE;
     }
+    const char *sock_path = NULL;
+    const char *trace_path = NULL;
+    int direct = 0;
+    int warm = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            sock_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--direct") == 0) {
+            direct = 1;
+        } else if (strcmp(argv[i], "--warm") == 0) {
+            warm = 1;
+        } else if (strcmp(argv[i], "--uring") == 0) {
+            // fall back to blocking reads when the kernel refuses a ring
+            if (uring_init(0) < 0)
+                fprintf(stderr, "io_uring unavailable, using blocking reads\n");
+        } else {
+            fprintf(stderr, "Usage Error : %s <EXT2_IMAGE> [--uring] [--direct] [--warm] [--trace <FILE>] [--serve <SOCKET>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
 
     // Initialize EXT2 structures
-    if (init_ext2_structures(argv[1]) < 0) {
+    if (init_ext2_structures(argv[1], direct) < 0) {
         return EXIT_FAILURE;
     }
+    // Record block accesses once the geometry for the trace header is known
+    if (trace_path && trace_open(trace_path) < 0) {
+        return EXIT_FAILURE;
+    }
+    // Prefetch inode tables and the root directory while the user types
+    if (warm) warm_start();
 
-    // Enter command loop
-    cmd_loop();
+    // Enter command loop, or answer socket clients until signalled
+    int status = EXIT_SUCCESS;
+    if (sock_path) {
+        if (serve(sock_path) < 0) status = EXIT_FAILURE;
+    } else {
+        cmd_loop();
+    }
 
     // Clean up: close the filesystem image file descriptor
+    warm_stop();
+    trace_close();
+    uring_exit();
+    free(gdt);
     close(fs_fd);
-    return EXIT_SUCCESS;
+    return status;
 }
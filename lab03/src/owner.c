@@ -0,0 +1,403 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <time.h>
+#include "header.h"
+
+#define EXT2_ROOT_INO   2
+#define OWNER_INDIRECT  UINT32_MAX   // Extent.lblk of an indirect block
+#define OWNER_MAX_DEPTH 256          // parent links followed when naming an inode
+
+/* -- One run of physical blocks owned by an inode -- */
+typedef struct {
+    uint32_t start, len;    // physical blocks [start, start + len)
+    uint32_t ino;
+    uint32_t lblk;          // logical block of 'start', or OWNER_INDIRECT
+} Extent;
+
+/* -- Blocks asked about, in order -- */
+typedef struct {
+    uint32_t *blocks;
+    size_t count, cap;
+} Query;
+
+/* -- Reverse index of the open image, built on first use -- */
+static Extent *extents;
+static size_t nextents, extents_cap;
+static uint32_t *parent;          // directory holding the first name of each inode
+static uint32_t *name_off;        // that name in 'names' (0 = unnamed)
+static char *names;
+static size_t names_len, names_cap;
+static int index_built = 0;
+static double index_seconds;
+
+/* -- Prototypes -- */
+static int add_extent(uint32_t ino, uint32_t blk, uint32_t lblk);
+static int add_name(uint32_t dir, const ext2_dir_entry_2 *e);
+static int index_dir_block(uint32_t dir, const char *data);
+static int index_ptr(uint32_t ino, int dir, uint32_t blk, int depth, uint64_t *lblk, char *buf);
+static int cmp_extent(const void *a, const void *b);
+static int build_index(void);
+static const Extent *find_extent(uint32_t blk);
+static void inode_path(uint32_t ino, char *out, size_t cap);
+static int group_meta(uint32_t blk, char *out, size_t cap);
+static int parse_block(const char *s, char **end, uint32_t *blk);
+static int add_blocks(Query *q, const char *arg);
+static int add_file(Query *q, const char *path);
+static void describe(uint32_t blk, char *bitmap, uint32_t *bitmap_group);
+static void help(void);
+
+// add_extent: record that 'ino' owns block 'blk', merging with the previous run
+static int add_extent(uint32_t ino, uint32_t blk, uint32_t lblk) {
+    if (nextents > 0) {
+        Extent *last = &extents[nextents - 1];
+        if (last->ino == ino && last->start + last->len == blk &&
+            (lblk == OWNER_INDIRECT ? last->lblk == OWNER_INDIRECT
+                                    : last->lblk != OWNER_INDIRECT && last->lblk + last->len == lblk)) {
+            last->len++;
+            return 0;
+        }
+    }
+    if (nextents == extents_cap) {
+        size_t cap = extents_cap ? extents_cap * 2 : 4096;
+        Extent *p = realloc(extents, cap * sizeof(Extent));
+        if (!p) return -1;
+        extents = p;
+        extents_cap = cap;
+    }
+    extents[nextents++] = (Extent){ blk, 1, ino, lblk };
+    return 0;
+}
+
+// add_name: remember the first name found for the inode of entry 'e' in 'dir'
+static int add_name(uint32_t dir, const ext2_dir_entry_2 *e) {
+    if (e->inode == 0 || e->inode > sb.s_inodes_count || name_off[e->inode]) return 0;
+    if (e->name_len == 1 && e->name[0] == '.') return 0;
+    if (e->name_len == 2 && e->name[0] == '.' && e->name[1] == '.') return 0;
+
+    if (names_len + e->name_len + 1 > names_cap) {
+        size_t cap = names_cap ? names_cap * 2 : 65536;
+        while (cap < names_len + e->name_len + 1) cap *= 2;
+        char *p = realloc(names, cap);
+        if (!p) return -1;
+        names = p;
+        names_cap = cap;
+    }
+    memcpy(names + names_len, e->name, e->name_len);
+    names[names_len + e->name_len] = '\0';
+    parent[e->inode] = dir;
+    name_off[e->inode] = (uint32_t)names_len;
+    names_len += e->name_len + 1;
+    return 0;
+}
+
+// index_dir_block: collect the names of one directory block
+static int index_dir_block(uint32_t dir, const char *data) {
+    int off = 0;
+    while (off + 8 <= block_size) {
+        const ext2_dir_entry_2 *e = (const ext2_dir_entry_2 *)(data + off);
+        if (e->rec_len < 8 || off + e->rec_len > block_size) break;
+        if (e->name_len + 8 <= e->rec_len && add_name(dir, e) < 0) return -1;
+        off += e->rec_len;
+    }
+    return 0;
+}
+
+// index_ptr: index one block pointer and everything below it.
+// buf holds one block per level: [0] directory data, [1..3] indirect
+static int index_ptr(uint32_t ino, int dir, uint32_t blk, int depth, uint64_t *lblk, char *buf) {
+    uint64_t span = 1;
+    for (int i = 0; i < depth; i++) span *= (uint64_t)(block_size / 4);
+    if (blk == 0 || blk < sb.s_first_data_block || blk >= sb.s_blocks_count) {
+        *lblk += span;   // a hole, or a pointer nothing can own
+        return 0;
+    }
+    if (add_extent(ino, blk, depth ? OWNER_INDIRECT : (uint32_t)*lblk) < 0) return -1;
+    if (depth == 0) {
+        (*lblk)++;
+        if (!dir) return 0;
+        if (read_blocks_as(blk, 1, buf, TRACE_DIR) < 0) return 0;
+        STAT_ADD(dir_blocks, 1);
+        return index_dir_block(ino, buf);
+    }
+
+    char *data = buf + (size_t)depth * block_size;
+    if (read_blocks_as(blk, 1, data, TRACE_INDIRECT) < 0) {
+        *lblk += span;
+        return 0;
+    }
+    const uint32_t *ptrs = (const uint32_t *)data;
+    for (int i = 0; i < block_size / 4; i++)
+        if (index_ptr(ino, dir, ptrs[i], depth - 1, lblk, buf) < 0) return -1;
+    return 0;
+}
+
+static int cmp_extent(const void *a, const void *b) {
+    const Extent *x = a, *y = b;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+// build_index: one sequential pass over every group's inode bitmap and inode
+// table, walking each inode's block pointers and directory entries
+static int build_index(void) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    size_t itable_len = ((size_t)sb.s_inodes_per_group * inode_size + block_size - 1)
+                        / block_size * block_size;
+    uint32_t table_blocks = (uint32_t)(itable_len / block_size);
+    char *table = malloc(itable_len);
+    char *bitmap = malloc(block_size);
+    char *walk = malloc((size_t)4 * block_size);
+    parent = calloc((size_t)sb.s_inodes_count + 1, sizeof(uint32_t));
+    name_off = calloc((size_t)sb.s_inodes_count + 1, sizeof(uint32_t));
+    // offset 0 is a placeholder so that 0 can mean "no name"
+    names_cap = 65536;
+    names = malloc(names_cap);
+    names_len = 1;
+    int ret = -1;
+    if (!table || !bitmap || !walk || !parent || !name_off || !names) {
+        perror("malloc");
+        goto out;
+    }
+    names[0] = '\0';
+    uint32_t first_ino = sb.s_rev_level ? sb.s_first_ino : 11;
+
+    for (uint32_t g = 0; g < group_count; g++) {
+        const ext2_group_desc *d = &gdt[g];
+        if (read_blocks_as(d->bg_inode_bitmap, 1, bitmap, TRACE_META) < 0 ||
+            read_blocks_as(d->bg_inode_table, table_blocks, table, TRACE_INODE) < 0) {
+            fprintf(ERR, "Error: cannot read inode table of group %" PRIu32 "\n", g);
+            continue;
+        }
+        for (uint32_t i = 0; i < sb.s_inodes_per_group; i++) {
+            uint32_t ino = g * sb.s_inodes_per_group + i + 1;
+            if (ino > sb.s_inodes_count) break;
+            if (!((bitmap[i / 8] >> (i % 8)) & 1)) continue;
+            // reserved inodes (bad blocks, resize, journal...) have their own layouts
+            if (ino < first_ino && ino != EXT2_ROOT_INO) continue;
+
+            ext2_inode inode;
+            size_t len = (size_t)inode_size < sizeof(inode) ? (size_t)inode_size : sizeof(inode);
+            memset(&inode, 0, sizeof(inode));
+            memcpy(&inode, table + (size_t)i * inode_size, len);
+            int dir = S_ISDIR(inode.i_mode);
+            if (!(dir || S_ISREG(inode.i_mode) || S_ISLNK(inode.i_mode))) continue;
+            // fast symlinks keep the target text in i_block
+            if (S_ISLNK(inode.i_mode) && inode.i_blocks == 0) continue;
+
+            uint64_t lblk = 0;
+            for (int b = 0; b < EXT2_N_BLOCKS; b++)
+                if (index_ptr(ino, dir, inode.i_block[b], b < 12 ? 0 : b - 11, &lblk, walk) < 0) {
+                    perror("realloc");
+                    goto out;
+                }
+        }
+    }
+
+    // inodes were walked in table order; queries search by physical block
+    qsort(extents, nextents, sizeof(Extent), cmp_extent);
+    Extent *p = realloc(extents, (nextents ? nextents : 1) * sizeof(Extent));
+    if (p) extents = p;
+    extents_cap = nextents;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    index_seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    index_built = 1;
+    ret = 0;
+
+out:
+    free(walk);
+    free(bitmap);
+    free(table);
+    if (ret < 0) {
+        free(extents);
+        free(parent);
+        free(name_off);
+        free(names);
+        extents = NULL;
+        parent = name_off = NULL;
+        names = NULL;
+        nextents = extents_cap = names_len = names_cap = 0;
+    }
+    return ret;
+}
+
+// find_extent: binary search for the run containing 'blk'
+static const Extent *find_extent(uint32_t blk) {
+    size_t lo = 0, hi = nextents;
+    while (lo < hi) {            // first extent starting after blk
+        size_t mid = lo + (hi - lo) / 2;
+        if (extents[mid].start <= blk) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return NULL;
+    const Extent *e = &extents[lo - 1];
+    return blk - e->start < e->len ? e : NULL;
+}
+
+// inode_path: absolute path of the first name of 'ino', built from the parent links
+static void inode_path(uint32_t ino, char *out, size_t cap) {
+    const char *parts[OWNER_MAX_DEPTH];
+    int n = 0;
+    uint32_t cur = ino;
+    while (cur != EXT2_ROOT_INO) {
+        if (cur > sb.s_inodes_count || !name_off[cur] || n == OWNER_MAX_DEPTH) {
+            snprintf(out, cap, "<unnamed inode %" PRIu32 ">", ino);
+            return;
+        }
+        parts[n++] = names + name_off[cur];
+        cur = parent[cur];
+    }
+    size_t len = 0;
+    out[0] = '\0';
+    if (n == 0) snprintf(out, cap, "/");
+    while (n > 0 && len < cap) {
+        int w = snprintf(out + len, cap - len, "/%s", parts[--n]);
+        if (w < 0) break;
+        len += w;
+    }
+}
+
+// group_meta: describe 'blk' if it is a bitmap or inode table block; returns 1 if so
+static int group_meta(uint32_t blk, char *out, size_t cap) {
+    uint32_t g = (blk - sb.s_first_data_block) / sb.s_blocks_per_group;
+    if (g >= group_count) return 0;
+    const ext2_group_desc *d = &gdt[g];
+    uint32_t per_block = (uint32_t)(block_size / inode_size);
+    uint32_t table_blocks = (sb.s_inodes_per_group + per_block - 1) / per_block;
+
+    if (blk == d->bg_block_bitmap) {
+        snprintf(out, cap, "block bitmap of group %" PRIu32, g);
+    } else if (blk == d->bg_inode_bitmap) {
+        snprintf(out, cap, "inode bitmap of group %" PRIu32, g);
+    } else if (blk >= d->bg_inode_table && blk - d->bg_inode_table < table_blocks) {
+        uint32_t first = g * sb.s_inodes_per_group + (blk - d->bg_inode_table) * per_block + 1;
+        snprintf(out, cap, "inode table of group %" PRIu32 " (inodes %" PRIu32 "-%" PRIu32 ")",
+                 g, first, first + per_block - 1);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// parse_block: decimal block number inside the image
+static int parse_block(const char *s, char **end, uint32_t *blk) {
+    errno = 0;
+    if (*s < '0' || *s > '9') return -1;
+    unsigned long long v = strtoull(s, end, 10);
+    if (errno || v >= sb.s_blocks_count) return -1;
+    *blk = (uint32_t)v;
+    return 0;
+}
+
+// add_blocks: append the blocks of 'arg' (BLOCK or FIRST-LAST) to the query
+static int add_blocks(Query *q, const char *arg) {
+    uint32_t first, last;
+    char *end;
+    if (parse_block(arg, &end, &first) < 0) return -1;
+    last = first;
+    if (*end == '-' && parse_block(end + 1, &end, &last) < 0) return -1;
+    if (*end || last < first) return -1;
+    for (uint64_t b = first; b <= last; b++) {
+        if (q->count == q->cap) {
+            size_t cap = q->cap ? q->cap * 2 : 64;
+            uint32_t *p = realloc(q->blocks, cap * sizeof(uint32_t));
+            if (!p) { perror("realloc"); return -2; }
+            q->blocks = p;
+            q->cap = cap;
+        }
+        q->blocks[q->count++] = (uint32_t)b;
+    }
+    return 0;
+}
+
+// add_file: append every whitespace separated BLOCK or FIRST-LAST of a host file
+static int add_file(Query *q, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(ERR, "Error: '%s' cannot open file\n", path);
+        return -1;
+    }
+    char word[64];
+    int ret = 0;
+    while (ret == 0 && fscanf(fp, "%63s", word) == 1) {
+        ret = add_blocks(q, word);
+        if (ret == -1) fprintf(ERR, "Error: '%s' is not a block number of the image\n", word);
+    }
+    fclose(fp);
+    return ret;
+}
+
+// describe: print the owner of one block
+static void describe(uint32_t blk, char *bitmap, uint32_t *bitmap_group) {
+    char what[MAX_PATH + 64];
+    const Extent *e = find_extent(blk);
+    if (e) {
+        inode_path(e->ino, what, sizeof(what));
+        if (e->lblk == OWNER_INDIRECT)
+            fprintf(OUT, "%" PRIu32 ": %s (inode %" PRIu32 ", indirect block)\n", blk, what, e->ino);
+        else
+            fprintf(OUT, "%" PRIu32 ": %s (inode %" PRIu32 ", block %" PRIu32 " of the file)\n",
+                    blk, what, e->ino, e->lblk + (blk - e->start));
+        return;
+    }
+    if (blk < sb.s_first_data_block) {
+        fprintf(OUT, "%" PRIu32 ": boot block\n", blk);
+        return;
+    }
+    if (group_meta(blk, what, sizeof(what))) {
+        fprintf(OUT, "%" PRIu32 ": %s\n", blk, what);
+        return;
+    }
+    // anything else in use belongs to the superblock, descriptors or a reserved inode
+    uint32_t g = (blk - sb.s_first_data_block) / sb.s_blocks_per_group;
+    uint32_t bit = (blk - sb.s_first_data_block) % sb.s_blocks_per_group;
+    if (g != *bitmap_group) {
+        if (read_blocks_as(gdt[g].bg_block_bitmap, 1, bitmap, TRACE_META) < 0) {
+            fprintf(ERR, "Error: cannot read block bitmap of group %" PRIu32 "\n", g);
+            *bitmap_group = UINT32_MAX;
+            return;
+        }
+        *bitmap_group = g;
+    }
+    if ((bitmap[bit / 8] >> (bit % 8)) & 1)
+        fprintf(OUT, "%" PRIu32 ": filesystem metadata (superblock, group descriptors or reserved inode)\n", blk);
+    else
+        fprintf(OUT, "%" PRIu32 ": free\n", blk);
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : owner <BLOCK|FIRST-LAST>... [-f <HOST_FILE>]\n");
+}
+
+// cmd_owner: name the file, or the metadata, each physical block belongs to
+void cmd_owner(int argc, char *argv[]) {
+    Query q = { NULL, 0, 0 };
+    int ok = argc >= 2;
+    for (int i = 1; ok && i < argc; i++) {
+        int r;
+        if (strcmp(argv[i], "-f") == 0) {
+            if (i + 1 >= argc) { ok = 0; break; }
+            r = add_file(&q, argv[++i]);
+        } else {
+            r = add_blocks(&q, argv[i]);
+            if (r == -1) fprintf(ERR, "Error: '%s' is not a block number of the image\n", argv[i]);
+        }
+        if (r < 0) { free(q.blocks); return; }
+    }
+    if (!ok) { help(); free(q.blocks); return; }
+
+    if (!index_built) {
+        if (build_index() < 0) { free(q.blocks); return; }
+        fprintf(OUT, "(indexed %zu extents in %.3f s)\n", nextents, index_seconds);
+    }
+    char *bitmap = malloc(block_size);
+    if (!bitmap) { perror("malloc"); free(q.blocks); return; }
+    uint32_t bitmap_group = UINT32_MAX;
+    for (size_t i = 0; i < q.count; i++)
+        describe(q.blocks[i], bitmap, &bitmap_group);
+    free(bitmap);
+    free(q.blocks);
+}
@@ -1,15 +1,65 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <fnmatch.h>
+#include <pthread.h>
 #include "header.h"
 
+#define PRINT_CHUNK    (256 * 1024)  // bytes per coalesced read
+#define PRINT_WINDOW   8             // runs fetched per batch
+#define PRINT_THREADS  8             // fetchers for multi-file print
+#define PRINT_INFLIGHT (16 << 20)    // fetched bytes waiting to be written
+#define PRINT_AHEAD    256           // files fetched ahead of the one being written
+
+/* -- Multi-file print -- */
+typedef struct Chunk {
+    struct Chunk *next;
+    size_t len;
+    char data[];
+} Chunk;
+
+typedef struct PrintFile {
+    char *path;
+    ext2_inode inode;
+    int error;            // 1 missing, 2 not a file, 3 read error (reported in order)
+    Chunk *head, *tail;   // fetched, not yet written
+    size_t queued;        // bytes in head..tail
+    int done;             // fetcher finished with this file
+    int stop;             // writer needs no more data (-n reached)
+} PrintFile;
+
+typedef struct FileList {
+    PrintFile *v;
+    int count, cap;
+} FileList;
+
+// Shared by the fetchers and the writer of one print command
+typedef struct Pipeline {
+    FileList *files;
+    int next_fetch;       // next file a fetcher claims
+    int emit;             // file being written
+    size_t inflight;      // bytes fetched and not yet written
+    int abort;            // output failed, stop everything
+    pthread_mutex_t lock;
+    pthread_cond_t ready; // data or completion for the writer
+    pthread_cond_t space; // budget freed or writer moved on
+} Pipeline;
+
 // Prototypes
 void cmd_print(int argc, char *argv[]);
-static int read_block(int blk, void *buf);
-static int read_inode(int ino, ext2_inode *buf);
-static int get_inode_by_path(const char *path, ext2_inode *inode);
 static int is_file(ext2_inode *inode);
 static void help(void);
-static void read_indirect(uint32_t blk, int level, uint32_t **out, int *count, int *cap);
+static int write_all(int fd, const char *buf, size_t len);
+static int emit_raw(const char *buf, size_t len);
+static void print_file(ext2_inode *inode, int max_lines);
+static void add_path(FileList *list, const char *path, const ext2_inode *inode, int error);
+static int has_glob(const char *s);
+static int collect_match(const ext2_dir_entry_2 *e, void *arg);
+static int cmp_names(const void *a, const void *b);
+static void expand_glob(FileList *list, const char *prefix, const ext2_inode *dir, const char *rest);
+static void fetch_file(Pipeline *pl, int idx);
+static void *fetch_worker(void *arg);
+static int emit_file(Pipeline *pl, int idx, int max_lines);
+static void print_files(FileList *list, int max_lines);
 
 // cmd_print: implement "print" command
 void cmd_print(int argc, char *argv[]) {
@@ -18,99 +68,407 @@ void cmd_print(int argc, char *argv[]) {
 		help();
         return;
     }
-    // parse path
-    const char *path = argv[1];
-    // parse options
-    int max_lines = -1;
-    for (int i = 2; i < argc; i++) {
+    // parse options; everything else is a path or a pattern
+    int max_lines = -1, npaths = 0, globbed = 0;
+    for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-n") == 0) {
             if (i + 1 >= argc) {
-                fprintf(stderr, "print: option requires an argument -- 'n'\n");
+                fprintf(ERR, "print: option requires an argument -- 'n'\n");
                 return;
             }
             max_lines = atoi(argv[i+1]);
             i++;
-        } else {
+        } else if (argv[i][0] == '-') {
             help();
             return;
+        } else {
+            npaths++;
+            globbed |= has_glob(argv[i]);
         }
     }
-    // get inode for path
-    ext2_inode inode;
-    if (get_inode_by_path(path, &inode) < 0) {
-        help();
+    if (npaths == 0) { help(); return; }
+
+    // one plain path: stream it directly
+    if (npaths == 1 && !globbed) {
+        const char *path = NULL;
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "-n") == 0) i++;
+            else path = argv[i];
+        }
+        // get inode for path
+        ext2_inode inode;
+        if (get_inode_by_path(path, &inode) < 0) {
+            help();
+            return;
+        }
+        // ensure it's a file, not directory
+        if (!is_file(&inode)) {
+            fprintf(ERR, "Error: '%s' is not file\n", path);
+            return;
+        }
+        print_file(&inode, max_lines);
         return;
     }
-    // ensure it's a file, not directory
-    if (!is_file(&inode)) {
-        fprintf(stderr, "Error: '%s' is not file\n", path);
-        return;
+
+    // expand every argument in order, patterns to their sorted matches
+    FileList list = { NULL, 0, 0 };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0) { i++; continue; }
+        ext2_inode inode;
+        if (!has_glob(argv[i])) {
+            int ok = get_inode_by_path(argv[i], &inode) >= 0;
+            add_path(&list, argv[i], &inode, !ok ? 1 : !is_file(&inode) ? 2 : 0);
+            continue;
+        }
+        int before = list.count;
+        if (read_inode(2, &inode) == 0)
+            expand_glob(&list, "", &inode, argv[i]);
+        if (list.count == before) add_path(&list, argv[i], &inode, 1);
     }
-    // open buffer for reading blocks
-    char *buf = malloc(block_size);
+    print_files(&list, max_lines);
+    for (int i = 0; i < list.count; i++) free(list.v[i].path);
+    free(list.v);
+}
+
+// print_file: stream one file, fetching a window of data runs per batch
+static void print_file(ext2_inode *inode, int max_lines) {
+    // raw writes below bypass the stdio buffer
+    fflush(OUT);
+    // stream data runs, fetching a window of them per batch
+    int window = max_lines < 0 ? PRINT_WINDOW : 1;
+    char *buf = malloc((size_t)window * PRINT_CHUNK);
     if (!buf) { perror("malloc"); return; }
-    uint32_t remaining = inode.i_size;
-    int lines_printed = 0;
-    
-    // array for block num
-    int cap = 16, count = 0;
-    uint32_t *blocks = malloc(cap * sizeof *blocks);
-
-    // direct (0..11)
-    for (int i = 0; i < 12; i++) {
-        if (inode.i_block[i]) {
-            if (count >= cap) {
-                cap *= 2;
-                blocks = realloc(blocks, cap * sizeof *blocks);
+    uint64_t remaining = inode_size64(inode);
+    int lines_printed = 0, done = 0;
+
+    block_iter it;
+    uint64_t lblk;
+    uint32_t pblk, len;
+    read_req reqs[PRINT_WINDOW];
+    size_t lens[PRINT_WINDOW];
+    biter_init(&it, inode);
+    while (!done && remaining > 0) {
+        int n = 0, nreq = 0;
+        uint64_t queued = 0;
+        while (n < window && queued < remaining
+               && biter_next(&it, &lblk, &pblk, &len, PRINT_CHUNK / block_size) > 0) {
+            size_t run = (size_t)len * block_size;
+            char *dst = buf + (size_t)n * PRINT_CHUNK;
+            lens[n] = remaining - queued < run ? (size_t)(remaining - queued) : run;
+            queued += lens[n];
+            // holes read back as zeros
+            if (!pblk) {
+                memset(dst, 0, lens[n]);
+            } else {
+                reqs[nreq].off = (off_t)pblk * block_size;
+                reqs[nreq].len = run;
+                reqs[nreq].buf = dst;
+                nreq++;
             }
-            blocks[count++] = inode.i_block[i];
+            n++;
         }
+        if (n == 0 || read_batch(reqs, nreq) < 0) break;
+
+        for (int r = 0; r < n && !done; r++) {
+            char *data = buf + (size_t)r * PRINT_CHUNK;
+            if (max_lines < 0) {
+                if (emit_raw(data, lens[r]) < 0) {
+                    perror("write");
+                    done = 1;
+                }
+                continue;
+            }
+            // emit whole lines until the requested count is reached
+            char *p = data, *end = data + lens[r];
+            while (p < end) {
+                char *nl = memchr(p, '\n', end - p);
+                char *stop = nl ? nl + 1 : end;
+                fwrite(p, 1, stop - p, OUT);
+                p = stop;
+                if (nl && ++lines_printed >= max_lines) {
+                    done = 1;
+                    break;
+                }
+            }
+        }
+        remaining -= queued;
+    }
+    if (max_lines >= 0) fflush(OUT);
+
+    biter_free(&it);
+    free(buf);
+}
+
+// add_path: append a file (or the error to report in its place)
+static void add_path(FileList *list, const char *path, const ext2_inode *inode, int error) {
+    if (list->count >= list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 16;
+        list->v = realloc(list->v, list->cap * sizeof *list->v);
+        if (!list->v) { perror("realloc"); exit(EXIT_FAILURE); }
     }
+    PrintFile *f = &list->v[list->count++];
+    memset(f, 0, sizeof(*f));
+    f->path = strdup(path);
+    if (!f->path) { perror("strdup"); exit(EXIT_FAILURE); }
+    if (!error) f->inode = *inode;
+    f->error = error;
+}
 
-    // single indirect
-    if (inode.i_block[12])
-        read_indirect(inode.i_block[12], 1, &blocks, &count, &cap);
+// has_glob: true if the string holds a shell pattern character
+static int has_glob(const char *s) {
+    return strpbrk(s, "*?[") != NULL;
+}
 
-    // double indirect
-    if (inode.i_block[13])
-        read_indirect(inode.i_block[13], 2, &blocks, &count, &cap);
+/* -- Pattern expansion -- */
+typedef struct { const char *pat; char **v; int count, cap; } MatchList;
 
-    // triple indirect
-    if (inode.i_block[14])
-        read_indirect(inode.i_block[14], 3, &blocks, &count, &cap);
+// collect_match: dir_iterate callback keeping names that match one path component
+static int collect_match(const ext2_dir_entry_2 *e, void *arg) {
+    MatchList *m = arg;
+    char name[EXT2_NAME_LEN+1] = {0};
+    memcpy(name, e->name, e->name_len);
+    // like the shell: '.' and '..' never match, leading dots only explicitly
+    if (!strcmp(name, ".") || !strcmp(name, "..") || fnmatch(m->pat, name, FNM_PERIOD) != 0)
+        return 0;
+    if (m->count >= m->cap) {
+        m->cap = m->cap ? m->cap * 2 : 16;
+        m->v = realloc(m->v, m->cap * sizeof *m->v);
+        if (!m->v) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    // keep the inode number right after the name's terminator
+    m->v[m->count] = malloc(e->name_len + 1 + sizeof(uint32_t));
+    if (!m->v[m->count]) { perror("malloc"); exit(EXIT_FAILURE); }
+    memcpy(m->v[m->count], name, e->name_len + 1);
+    memcpy(m->v[m->count] + e->name_len + 1, &e->inode, sizeof(uint32_t));
+    m->count++;
+    return 0;
+}
 
-    for (int idx = 0; idx < count && remaining > 0; idx++) {
-        uint32_t blk = blocks[idx];
-        if (read_block(blk, buf) < 0) break;
+static int cmp_names(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
 
-        uint32_t to_write = remaining < (uint32_t)block_size
-                        ? (uint32_t)remaining
-                        : (uint32_t)block_size;
+// expand_glob: add every path under 'dir' matching the components in 'rest', sorted per level
+static void expand_glob(FileList *list, const char *prefix, const ext2_inode *dir, const char *rest) {
+    while (*rest == '/') rest++;
+    if (!*rest) return;
+    const char *slash = strchr(rest, '/');
+    size_t clen = slash ? (size_t)(slash - rest) : strlen(rest);
+    char comp[EXT2_NAME_LEN+1];
+    if (clen > EXT2_NAME_LEN || !is_dir(dir)) return;
+    memcpy(comp, rest, clen);
+    comp[clen] = '\0';
+    const char *next = slash ? slash : "";
+    int last = !*next || strspn(next, "/") == strlen(next);
 
-        if (max_lines < 0) {
-            if (write(STDOUT_FILENO, buf, to_write) < 0) {
-                perror("write");
-                break;
-            }
+    // plain component: resolve it without listing the directory
+    if (!has_glob(comp)) {
+        char path[MAX_PATH];
+        ext2_inode child;
+        snprintf(path, sizeof(path), "%s/%s", prefix, comp);
+        if (get_inode_by_path(path, &child) < 0) return;
+        if (last) add_path(list, path, &child, is_file(&child) ? 0 : 2);
+        else expand_glob(list, path, &child, next);
+        return;
+    }
+
+    MatchList m = { comp, NULL, 0, 0 };
+    dir_iterate(dir, collect_match, &m);
+    if (m.count > 1) qsort(m.v, m.count, sizeof(*m.v), cmp_names);
+    for (int i = 0; i < m.count; i++) {
+        char path[MAX_PATH];
+        uint32_t ino;
+        ext2_inode child;
+        memcpy(&ino, m.v[i] + strlen(m.v[i]) + 1, sizeof(ino));
+        snprintf(path, sizeof(path), "%s/%s", prefix, m.v[i]);
+        if (read_inode(ino, &child) == 0) {
+            if (last) add_path(list, path, &child, is_file(&child) ? 0 : 2);
+            else if (is_dir(&child)) expand_glob(list, path, &child, next);
+        }
+        free(m.v[i]);
+    }
+    free(m.v);
+}
+
+// fetch_file: read one file run by run into its chunk queue, staying inside
+// the in-flight budget (the file being written may always keep two chunks)
+static void fetch_file(Pipeline *pl, int idx) {
+    PrintFile *f = &pl->files->v[idx];
+    uint64_t remaining = f->error ? 0 : inode_size64(&f->inode);
+    block_iter it;
+    uint64_t lblk;
+    uint32_t pblk, len;
+
+    biter_init(&it, &f->inode);
+    while (remaining > 0 && biter_next(&it, &lblk, &pblk, &len, PRINT_CHUNK / block_size) > 0) {
+        size_t run = (size_t)len * block_size;
+        size_t bytes = remaining < run ? (size_t)remaining : run;
+
+        pthread_mutex_lock(&pl->lock);
+        while (!f->stop && !pl->abort && pl->inflight + bytes > PRINT_INFLIGHT
+               && (idx != pl->emit || f->queued >= 2 * PRINT_CHUNK))
+            pthread_cond_wait(&pl->space, &pl->lock);
+        int quit = f->stop || pl->abort;
+        if (!quit) pl->inflight += bytes;
+        pthread_mutex_unlock(&pl->lock);
+        if (quit) break;
+
+        // holes read back as zeros
+        Chunk *c = malloc(sizeof(Chunk) + run);
+        int ok = c != NULL;
+        if (ok && !pblk) memset(c->data, 0, bytes);
+        else if (ok) ok = read_blocks(pblk, len, c->data) == 0;
+
+        pthread_mutex_lock(&pl->lock);
+        if (!ok) {
+            pl->inflight -= bytes;
+            f->error = 3;
+            pthread_mutex_unlock(&pl->lock);
+            free(c);
+            break;
+        }
+        c->next = NULL;
+        c->len = bytes;
+        if (f->tail) f->tail->next = c;
+        else f->head = c;
+        f->tail = c;
+        f->queued += bytes;
+        if (idx == pl->emit) pthread_cond_signal(&pl->ready);
+        pthread_mutex_unlock(&pl->lock);
+        remaining -= bytes;
+    }
+    biter_free(&it);
+
+    pthread_mutex_lock(&pl->lock);
+    f->done = 1;
+    if (idx == pl->emit) pthread_cond_signal(&pl->ready);
+    pthread_mutex_unlock(&pl->lock);
+}
+
+// fetch_worker: claim files in argument order, at most PRINT_AHEAD past the writer
+static void *fetch_worker(void *arg) {
+    Pipeline *pl = arg;
+    if (tracing) trace_command("print", 1);
+    pthread_mutex_lock(&pl->lock);
+    while (!pl->abort && pl->next_fetch < pl->files->count) {
+        if (pl->next_fetch >= pl->emit + PRINT_AHEAD) {
+            pthread_cond_wait(&pl->space, &pl->lock);
+            continue;
+        }
+        int idx = pl->next_fetch++;
+        pthread_mutex_unlock(&pl->lock);
+        fetch_file(pl, idx);
+        pthread_mutex_lock(&pl->lock);
+    }
+    pthread_mutex_unlock(&pl->lock);
+    return NULL;
+}
+
+// emit_file: write file 'idx' as its chunks arrive; -1 if output failed
+static int emit_file(Pipeline *pl, int idx, int max_lines) {
+    PrintFile *f = &pl->files->v[idx];
+    int lines_printed = 0, enough = 0, ret = 0;
+
+    pthread_mutex_lock(&pl->lock);
+    pl->emit = idx;
+    pthread_cond_broadcast(&pl->space);
+    for (;;) {
+        while (!f->head && !f->done)
+            pthread_cond_wait(&pl->ready, &pl->lock);
+        Chunk *c = f->head;
+        if (!c) break;
+        f->head = c->next;
+        if (!f->head) f->tail = NULL;
+        f->queued -= c->len;
+        pthread_mutex_unlock(&pl->lock);
+
+        if (enough) {
+            // -n reached: drop what was fetched anyway
+        } else if (max_lines < 0) {
+            if (emit_raw(c->data, c->len) < 0) ret = -1;
         } else {
-            for (uint32_t j = 0; j < to_write; j++) {
-                putchar(buf[j]);
-                if (buf[j] == '\n' && ++lines_printed >= max_lines) {
-                    free(buf);
-                    free(blocks);
-                    return;
-                }
+            // emit whole lines until the requested count is reached
+            char *p = c->data, *end = c->data + c->len;
+            while (p < end && !enough) {
+                char *nl = memchr(p, '\n', end - p);
+                char *stop = nl ? nl + 1 : end;
+                fwrite(p, 1, stop - p, OUT);
+                p = stop;
+                if (nl && ++lines_printed >= max_lines) enough = 1;
             }
         }
-        remaining -= to_write;
+
+        pthread_mutex_lock(&pl->lock);
+        pl->inflight -= c->len;
+        free(c);
+        f->stop = enough;
+        if (ret < 0) pl->abort = 1;
+        pthread_cond_broadcast(&pl->space);
+        if (ret < 0) break;
     }
+    pthread_mutex_unlock(&pl->lock);
+    return ret;
+}
 
-    free(blocks);
+// print_files: fetch many files concurrently and write them in argument order
+static void print_files(FileList *list, int max_lines) {
+    Pipeline pl;
+    memset(&pl, 0, sizeof(pl));
+    pl.files = list;
+    pthread_mutex_init(&pl.lock, NULL);
+    pthread_cond_init(&pl.ready, NULL);
+    pthread_cond_init(&pl.space, NULL);
+
+    int nthreads = list->count < PRINT_THREADS ? list->count : PRINT_THREADS;
+    pthread_t tids[PRINT_THREADS];
+    int started = 0;
+    for (int i = 0; i < nthreads; i++)
+        if (pthread_create(&tids[started], NULL, fetch_worker, &pl) == 0) started++;
+    if (started == 0 && list->count > 0) {
+        fprintf(ERR, "Error: cannot start print threads\n");
+        pl.abort = 1;
+    }
+
+    // raw writes below bypass the stdio buffer
+    fflush(OUT);
+    for (int i = 0; !pl.abort && i < list->count; i++) {
+        PrintFile *f = &list->v[i];
+        if (f->error == 1 || f->error == 2) {
+            fflush(OUT);
+            fprintf(ERR, f->error == 1 ? "Error: '%s' no such file\n" : "Error: '%s' is not file\n", f->path);
+            fflush(ERR);
+        }
+        if (emit_file(&pl, i, max_lines) < 0) {
+            perror("write");
+            break;
+        }
+        if (f->error == 3) fprintf(ERR, "Error: '%s' read error\n", f->path);
+        if (max_lines >= 0) fflush(OUT);
+    }
+
+    // let the fetchers see the end and drop anything still queued
+    pthread_mutex_lock(&pl.lock);
+    pl.abort = 1;
+    pl.emit = list->count;
+    pthread_cond_broadcast(&pl.space);
+    pthread_mutex_unlock(&pl.lock);
+    for (int i = 0; i < started; i++)
+        pthread_join(tids[i], NULL);
+    for (int i = 0; i < list->count; i++) {
+        while (list->v[i].head) {
+            Chunk *c = list->v[i].head;
+            list->v[i].head = c->next;
+            free(c);
+        }
+    }
+    pthread_cond_destroy(&pl.space);
+    pthread_cond_destroy(&pl.ready);
+    pthread_mutex_destroy(&pl.lock);
 }
 
 // print usage
 static void help(void) {
-	printf("Usage : print <PATH> [OPTION]...\n");
+	fprintf(OUT, "Usage : print <PATH>... [OPTION]...\n");
 }
 
 // is_file: true if inode is regular file
@@ -119,90 +477,20 @@ static int is_file(ext2_inode *inode) {
     return !S_ISDIR(inode->i_mode);
 }
 
-// read_block: read block from disk image
-static int read_block(int blk, void *buf) {
-    off_t off = (off_t)blk * block_size;
-    if (lseek(fs_fd, off, SEEK_SET) < 0) return -1;
-    return read(fs_fd, buf, block_size) == block_size ? 0 : -1;
-}
-
-// read_inode: read inode from inode table
-static int read_inode(int ino, ext2_inode *buf) {
-    off_t base = (off_t)gd.bg_inode_table * block_size;
-    off_t off = base + (ino - 1) * inode_size;
-    if (lseek(fs_fd, off, SEEK_SET) < 0) return -1;
-    return read(fs_fd, buf, inode_size) == inode_size ? 0 : -1;
-}
-
-// get_inode_by_path: same logic as in tree.c
-static int get_inode_by_path(const char *path, ext2_inode *inode) {
-    // special-case root
-    if (strcmp(path, ".") == 0 || strcmp(path, "/") == 0) {
-        if (read_inode(2, inode) < 0) return -1;
-        return 2;
-    }
-    char *copy = strdup(path);
-    if (!copy) return -1;
-    int cur_ino = 2;
-    ext2_inode cur;
-    if (read_inode(cur_ino, &cur) < 0) { free(copy); return -1; }
-    char *tok = strtok(copy, "/");
-    while (tok) {
-        if (!S_ISDIR(cur.i_mode)) break;
-        int blocks = (cur.i_size + block_size - 1) / block_size;
-        char *buf = malloc(block_size);
-        int found = 0;
-        for (int bi = 0; bi < blocks && !found; bi++) {
-            uint32_t blk = cur.i_block[bi];
-            if (!blk || read_block(blk, buf) < 0) continue;
-            int off = 0;
-            while (off < block_size) {
-                ext2_dir_entry_2 *e = (ext2_dir_entry_2*)(buf + off);
-                if (e->inode) {
-                    char name[EXT2_NAME_LEN+1] = {0};
-                    memcpy(name, e->name, e->name_len);
-                    if (strcmp(name, tok) == 0) {
-                        cur_ino = e->inode;
-                        if (read_inode(cur_ino, &cur) < 0) { free(buf); break; }
-                        found = 1;
-                        break;
-                    }
-                }
-                off += e->rec_len;
-            }
-        }
-        free(buf);
-        if (!found) break;
-        tok = strtok(NULL, "/");
-    }
-    free(copy);
-    if (tok) return -1;
-    *inode = cur;
-    return cur_ino;
-}
-
-static void read_indirect(uint32_t blk, int level, uint32_t **out, int *count, int *cap) {
-    // block num buffer
-    uint32_t *buf = malloc(block_size);
-    if (!buf) return;
-    // read block
-    if (read_block(blk, buf) < 0) { free(buf); return; }
-    int entries = block_size / sizeof(uint32_t);
-
-    for (int i = 0; i < entries; i++) {
-        uint32_t nblk = buf[i];
-        if (!nblk) break;
-        if (level == 1) {
-            // data block
-            if (*count >= *cap) {
-                *cap *= 2;
-                *out = realloc(*out, (*cap) * sizeof(uint32_t));
-            }
-            (*out)[(*count)++] = nblk;
-        } else {
-            read_indirect(nblk, level - 1, out, count, cap);
-        }
+// write_all: write the whole buffer, retrying on short writes
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) return -1;
+        buf += n;
+        len -= n;
     }
-    free(buf);
+    return 0;
 }
 
+// emit_raw: unbuffered output to OUT; a server frame stream has no fd, so go through stdio
+static int emit_raw(const char *buf, size_t len) {
+    int fd = fileno(OUT);
+    if (fd < 0) return fwrite(buf, 1, len, OUT) == len ? 0 : -1;
+    return write_all(fd, buf, len);
+}
@@ -0,0 +1,314 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "header.h"
+
+#define SERVE_THREADS 8     // request workers
+#define SERVE_QUEUE   256   // accepted connections waiting for a worker
+#define SERVE_BACKLOG 64    // listen() backlog
+#define FRAME_BUF     (64 * 1024)   // output bytes gathered per frame
+
+/* -- Response frames: 1 type byte, 4-byte big-endian length, payload -- */
+#define FRAME_OUT  'O'      // command output
+#define FRAME_ERR  'E'      // error / diagnostic text
+#define FRAME_END  'Z'      // end of response, 1-byte status payload
+
+/* -- Prototypes -- */
+static void on_signal(int sig);
+static void queue_push(int fd);
+static int queue_pop(void);
+static int send_all(int fd, const void *buf, size_t len);
+static int send_frame(int fd, char type, const void *buf, size_t len);
+static ssize_t frame_write(void *cookie, const char *buf, size_t len);
+static int frame_close(void *cookie);
+static void handle_request(int argc, char *argv[]);
+static void serve_client(int slot, int fd);
+static void *worker(void *arg);
+
+/* -- Connection queue (accept loop -> workers) -- */
+static int conn_queue[SERVE_QUEUE];
+static int q_head = 0, q_count = 0, q_closed = 0;
+static pthread_mutex_t q_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t q_nonempty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t q_nonfull = PTHREAD_COND_INITIALIZER;
+
+/* -- Framed stream behind cmd_out / cmd_err -- */
+typedef struct {
+    int fd;
+    char type;          // FRAME_OUT or FRAME_ERR
+    FILE *before;       // flushed first so frames leave in the order written
+    int frames;         // frames sent since the last end frame
+} FrameSink;
+
+// client socket each worker is serving, -1 when idle (for shutdown)
+static int active_fd[SERVE_THREADS];
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// queue_push: hand an accepted connection to the pool, waiting while it is full
+static void queue_push(int fd) {
+    pthread_mutex_lock(&q_lock);
+    while (q_count == SERVE_QUEUE && !q_closed)
+        pthread_cond_wait(&q_nonfull, &q_lock);
+    conn_queue[(q_head + q_count) % SERVE_QUEUE] = fd;
+    q_count++;
+    pthread_cond_signal(&q_nonempty);
+    pthread_mutex_unlock(&q_lock);
+}
+
+// queue_pop: next connection, or -1 once the server is shutting down
+static int queue_pop(void) {
+    pthread_mutex_lock(&q_lock);
+    while (q_count == 0 && !q_closed)
+        pthread_cond_wait(&q_nonempty, &q_lock);
+    int fd = -1;
+    if (q_count > 0) {
+        fd = conn_queue[q_head];
+        q_head = (q_head + 1) % SERVE_QUEUE;
+        q_count--;
+        pthread_cond_signal(&q_nonfull);
+    }
+    pthread_mutex_unlock(&q_lock);
+    return fd;
+}
+
+// send_all: write the whole buffer, retrying on short writes
+static int send_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// send_frame: one frame header plus its payload
+static int send_frame(int fd, char type, const void *buf, size_t len) {
+    unsigned char hdr[5];
+    hdr[0] = (unsigned char)type;
+    hdr[1] = (unsigned char)(len >> 24);
+    hdr[2] = (unsigned char)(len >> 16);
+    hdr[3] = (unsigned char)(len >> 8);
+    hdr[4] = (unsigned char)len;
+    if (send_all(fd, hdr, sizeof(hdr)) < 0) return -1;
+    return send_all(fd, buf, len);
+}
+
+// frame_write: stdio write hook, each flushed buffer becomes one or more frames
+static ssize_t frame_write(void *cookie, const char *buf, size_t len) {
+    FrameSink *sink = cookie;
+    if (sink->before && fflush(sink->before) == EOF) return -1;
+    for (size_t off = 0; off < len; ) {
+        size_t n = len - off < FRAME_BUF ? len - off : FRAME_BUF;
+        if (send_frame(sink->fd, sink->type, buf + off, n) < 0) return -1;
+        off += n;
+    }
+    if (len > 0) sink->frames++;
+    return (ssize_t)len;
+}
+
+// frame_close: the socket belongs to serve_client
+static int frame_close(void *cookie) {
+    (void)cookie;
+    return 0;
+}
+
+// handle_request: run one read-only query; output goes to the client
+static void handle_request(int argc, char *argv[]) {
+    if (tracing) trace_command(argv[0], 1);
+    if (strcmp(argv[0], "tree") == 0) {
+        cmd_tree(argc, argv);
+    } else if (strcmp(argv[0], "print") == 0) {
+        cmd_print(argc, argv);
+    } else if (strcmp(argv[0], "find") == 0) {
+        cmd_find(argc, argv);
+    } else if (strcmp(argv[0], "stat") == 0) {
+        cmd_stat(argc, argv);
+    } else {
+        fprintf(ERR, "Error: '%s' is not a server request (tree, print, find, stat)\n", argv[0]);
+    }
+}
+
+// serve_client: answer request lines until the client hangs up.
+// A response is a sequence of frames, each a type byte, a 4-byte big-endian
+// payload length and the payload: 'O' carries command output (any bytes,
+// print may send binary data), 'E' carries error text, and a final 'Z' frame
+// with a 1-byte payload ends the response (status 0, or 1 if any 'E' frame
+// was sent). Output is streamed in frames of at most FRAME_BUF bytes as it is
+// produced, so one connection can carry any number of requests.
+static void serve_client(int slot, int fd) {
+    FILE *in = fdopen(fd, "r");
+    if (!in) {
+        close(fd);
+        return;
+    }
+    cookie_io_functions_t io = { .write = frame_write, .close = frame_close };
+    FrameSink out_sink = { fd, FRAME_OUT, NULL, 0 };
+    FrameSink err_sink = { fd, FRAME_ERR, NULL, 0 };
+    FILE *out = fopencookie(&out_sink, "w", io);
+    FILE *err = fopencookie(&err_sink, "w", io);
+    if (!out || !err) {
+        if (out) fclose(out);
+        if (err) fclose(err);
+        fclose(in);
+        return;
+    }
+    setvbuf(out, NULL, _IOFBF, FRAME_BUF);
+    setvbuf(err, NULL, _IONBF, 0);
+    err_sink.before = out;
+
+    pthread_mutex_lock(&q_lock);
+    active_fd[slot] = fd;
+    pthread_mutex_unlock(&q_lock);
+
+    cmd_out = out;
+    cmd_err = err;
+    char line[MAX_LINE];
+    char *argv[MAX_ARG + 1];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        // tokenize
+        int argc = 0;
+        char *save = NULL;
+        char *token = strtok_r(line, " \t\r\n", &save);
+        while (token && argc < MAX_ARG) {
+            argv[argc++] = token;
+            token = strtok_r(NULL, " \t\r\n", &save);
+        }
+        argv[argc] = NULL;
+        if (argc == 0) continue;
+        if (strcmp(argv[0], "exit") == 0) break;
+
+        warm_hold();
+        handle_request(argc, argv);
+        warm_release();
+        if (fflush(out) == EOF || fflush(err) == EOF) break;
+        char status = err_sink.frames > 0;
+        err_sink.frames = 0;
+        if (send_frame(fd, FRAME_END, &status, 1) < 0) break;
+    }
+    cmd_out = cmd_err = NULL;
+
+    pthread_mutex_lock(&q_lock);
+    active_fd[slot] = -1;
+    pthread_mutex_unlock(&q_lock);
+    fclose(err);
+    fclose(out);
+    fclose(in);
+}
+
+// worker: serve queued connections until shutdown
+static void *worker(void *arg) {
+    int slot = (int)(intptr_t)arg;
+    int fd;
+    while ((fd = queue_pop()) >= 0)
+        serve_client(slot, fd);
+    return NULL;
+}
+
+// serve: answer queries on a Unix socket with the image and caches kept warm
+int serve(const char *sock_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(sock_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: '%s' socket path is too long\n", sock_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, sock_path);
+
+    // replace a stale socket left by an earlier server, never another file
+    struct stat st;
+    if (lstat(sock_path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "Error: '%s' exists and is not a socket\n", sock_path);
+            return -1;
+        }
+        unlink(sock_path);
+    }
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lfd < 0) { perror("socket"); return -1; }
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        close(lfd);
+        return -1;
+    }
+    if (listen(lfd, SERVE_BACKLOG) < 0) {
+        perror("listen");
+        close(lfd);
+        unlink(sock_path);
+        return -1;
+    }
+
+    // SIGINT / SIGTERM interrupt accept(); clients that go away must not kill us
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // workers inherit a mask that leaves the signals to the accept loop
+    sigset_t mask, old;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, &old);
+    pthread_t tids[SERVE_THREADS];
+    int started = 0;
+    for (int i = 0; i < SERVE_THREADS; i++) {
+        active_fd[i] = -1;
+        if (pthread_create(&tids[started], NULL, worker, (void *)(intptr_t)started) == 0)
+            started++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (started == 0) {
+        fprintf(stderr, "Error: cannot start server threads\n");
+        close(lfd);
+        unlink(sock_path);
+        return -1;
+    }
+
+    fprintf(stderr, "serving on %s with %d threads\n", sock_path, started);
+    while (!stop_requested) {
+        int cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("accept");
+            break;
+        }
+        queue_push(cfd);
+    }
+
+    // stop taking work, wake idle workers and end open sessions
+    close(lfd);
+    unlink(sock_path);
+    pthread_mutex_lock(&q_lock);
+    q_closed = 1;
+    while (q_count > 0) {
+        close(conn_queue[q_head]);
+        q_head = (q_head + 1) % SERVE_QUEUE;
+        q_count--;
+    }
+    for (int i = 0; i < started; i++)
+        if (active_fd[i] >= 0) shutdown(active_fd[i], SHUT_RD);
+    pthread_cond_broadcast(&q_nonempty);
+    pthread_cond_broadcast(&q_nonfull);
+    pthread_mutex_unlock(&q_lock);
+    for (int i = 0; i < started; i++)
+        pthread_join(tids[i], NULL);
+    return 0;
+}
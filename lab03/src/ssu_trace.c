@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "header.h"
+
+#define MAX_SIZES 16
+#define DEFAULT_SIZES "64,256,1024,4096,16384"
+#define DEFAULT_KINDS "dir,inode,indirect,meta"   // what the block cache holds
+
+/* -- Prototypes -- */
+static int parse_kinds(const char *list, int *mask);
+static int parse_sizes(const char *list, uint32_t *sizes);
+static int load_trace(const char *path, uint32_t kind_mask, int cmd);
+static void sim_init(uint32_t cap);
+static void sim_free(void);
+static int sim_find(uint32_t blk);
+static void sim_unhash(int slot);
+static void sim_hash(int slot);
+static void lru_unlink(int slot);
+static void lru_push_front(int slot);
+static uint64_t run_policy(int policy, uint32_t cap);
+static void help(void);
+
+/* -- Trace as loaded -- */
+static trace_header hdr;
+static char (*cmd_names)[TRACE_NAME_LEN];
+static uint32_t *refs;               // one entry per block touched, in order
+static uint64_t nrefs, refs_cap;
+static uint64_t recs_by_kind[TRACE_KINDS], blocks_by_kind[TRACE_KINDS];
+static uint64_t *recs_by_cmd, *blocks_by_cmd;
+static uint64_t nrecs, last_ns;
+
+static const char *kind_names[TRACE_KINDS] = { "dir", "inode", "indirect", "data", "meta" };
+
+/* -- Cache being simulated: slots chained into a hash and kept in policy order -- */
+enum { POL_LRU, POL_FIFO, POL_CLOCK, POL_COUNT };
+static const char *policy_names[POL_COUNT] = { "LRU", "FIFO", "CLOCK" };
+static uint32_t *slot_blk;
+static int *slot_hnext, *slot_prev, *slot_next;
+static uint8_t *slot_ref;
+static int *buckets;
+static uint32_t bucket_mask;
+static int lru_head, lru_tail;
+
+// parse_kinds: "dir,inode,..." or "all" to a bit mask of TRACE_* kinds
+static int parse_kinds(const char *list, int *mask) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s", list);
+    *mask = 0;
+    char *save = NULL;
+    for (char *t = strtok_r(buf, ",", &save); t; t = strtok_r(NULL, ",", &save)) {
+        if (strcmp(t, "all") == 0) { *mask = (1 << TRACE_KINDS) - 1; continue; }
+        int k = 0;
+        while (k < TRACE_KINDS && strcmp(kind_names[k], t) != 0) k++;
+        if (k == TRACE_KINDS) {
+            fprintf(stderr, "Error: '%s' is not a block kind (dir, inode, indirect, data, meta, all)\n", t);
+            return -1;
+        }
+        *mask |= 1 << k;
+    }
+    return *mask ? 0 : -1;
+}
+
+// parse_sizes: comma separated cache sizes in blocks
+static int parse_sizes(const char *list, uint32_t *sizes) {
+    int n = 0;
+    const char *p = list;
+    while (*p) {
+        char *end;
+        unsigned long v = strtoul(p, &end, 10);
+        if (end == p || v == 0 || v > (1u << 26) || n == MAX_SIZES || (*end && *end != ',')) {
+            fprintf(stderr, "Error: '%s' is not a list of cache sizes\n", list);
+            return -1;
+        }
+        sizes[n++] = (uint32_t)v;
+        p = *end ? end + 1 : end;
+    }
+    return n;
+}
+
+// load_trace: read the header and expand the selected records into block references
+static int load_trace(const char *path, uint32_t kind_mask, int cmd) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: '%s' cannot open trace file\n", path);
+        return -1;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || memcmp(hdr.magic, TRACE_MAGIC, 4) != 0
+        || hdr.version != TRACE_VERSION) {
+        fprintf(stderr, "Error: '%s' is not a block trace\n", path);
+        fclose(fp);
+        return -1;
+    }
+    cmd_names = calloc(hdr.ncmds ? hdr.ncmds : 1, TRACE_NAME_LEN);
+    recs_by_cmd = calloc(hdr.ncmds ? hdr.ncmds : 1, sizeof(uint64_t));
+    blocks_by_cmd = calloc(hdr.ncmds ? hdr.ncmds : 1, sizeof(uint64_t));
+    if (!cmd_names || !recs_by_cmd || !blocks_by_cmd
+        || fread(cmd_names, TRACE_NAME_LEN, hdr.ncmds, fp) != hdr.ncmds) {
+        fprintf(stderr, "Error: '%s' has a truncated header\n", path);
+        fclose(fp);
+        return -1;
+    }
+    for (int i = 0; i < hdr.ncmds; i++) cmd_names[i][TRACE_NAME_LEN - 1] = '\0';
+
+    trace_rec recs[1024];
+    size_t got;
+    while ((got = fread(recs, sizeof(trace_rec), 1024, fp)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            const trace_rec *r = &recs[i];
+            if (r->kind >= TRACE_KINDS || r->cmd >= hdr.ncmds) continue;
+            nrecs++;
+            last_ns = r->ns;
+            recs_by_kind[r->kind]++;
+            blocks_by_kind[r->kind] += r->count;
+            recs_by_cmd[r->cmd]++;
+            blocks_by_cmd[r->cmd] += r->count;
+            if (!(kind_mask & (1u << r->kind)) || (cmd >= 0 && r->cmd != cmd)) continue;
+
+            if (nrefs + r->count > refs_cap) {
+                uint64_t cap = refs_cap ? refs_cap * 2 : 1 << 16;
+                while (cap < nrefs + r->count) cap *= 2;
+                uint32_t *p = realloc(refs, cap * sizeof(uint32_t));
+                if (!p) { perror("realloc"); fclose(fp); return -1; }
+                refs = p;
+                refs_cap = cap;
+            }
+            for (uint32_t b = 0; b < r->count; b++) refs[nrefs++] = r->blk + b;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+// sim_init: empty cache of 'cap' slots
+static void sim_init(uint32_t cap) {
+    uint32_t nb = 1;
+    while (nb < cap * 2) nb <<= 1;
+    bucket_mask = nb - 1;
+    buckets = malloc(nb * sizeof(int));
+    slot_blk = malloc(cap * sizeof(uint32_t));
+    slot_hnext = malloc(cap * sizeof(int));
+    slot_prev = malloc(cap * sizeof(int));
+    slot_next = malloc(cap * sizeof(int));
+    slot_ref = calloc(cap, 1);
+    if (!buckets || !slot_blk || !slot_hnext || !slot_prev || !slot_next || !slot_ref) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    memset(buckets, -1, nb * sizeof(int));
+    lru_head = lru_tail = -1;
+}
+
+static void sim_free(void) {
+    free(buckets); free(slot_blk); free(slot_hnext);
+    free(slot_prev); free(slot_next); free(slot_ref);
+}
+
+// sim_find: slot holding 'blk', or -1
+static int sim_find(uint32_t blk) {
+    for (int s = buckets[(blk * 2654435761u) & bucket_mask]; s >= 0; s = slot_hnext[s])
+        if (slot_blk[s] == blk) return s;
+    return -1;
+}
+
+static void sim_hash(int slot) {
+    uint32_t b = (slot_blk[slot] * 2654435761u) & bucket_mask;
+    slot_hnext[slot] = buckets[b];
+    buckets[b] = slot;
+}
+
+static void sim_unhash(int slot) {
+    int *p = &buckets[(slot_blk[slot] * 2654435761u) & bucket_mask];
+    while (*p != slot) p = &slot_hnext[*p];
+    *p = slot_hnext[slot];
+}
+
+static void lru_unlink(int slot) {
+    if (slot_prev[slot] >= 0) slot_next[slot_prev[slot]] = slot_next[slot];
+    else lru_head = slot_next[slot];
+    if (slot_next[slot] >= 0) slot_prev[slot_next[slot]] = slot_prev[slot];
+    else lru_tail = slot_prev[slot];
+}
+
+static void lru_push_front(int slot) {
+    slot_prev[slot] = -1;
+    slot_next[slot] = lru_head;
+    if (lru_head >= 0) slot_prev[lru_head] = slot;
+    lru_head = slot;
+    if (lru_tail < 0) lru_tail = slot;
+}
+
+// run_policy: replay the references through a 'cap'-block cache; returns hits
+static uint64_t run_policy(int policy, uint32_t cap) {
+    uint64_t hits = 0;
+    uint32_t used = 0, hand = 0;
+
+    sim_init(cap);
+    for (uint64_t i = 0; i < nrefs; i++) {
+        uint32_t blk = refs[i];
+        int s = sim_find(blk);
+        if (s >= 0) {
+            hits++;
+            if (policy == POL_LRU) { lru_unlink(s); lru_push_front(s); }
+            else if (policy == POL_CLOCK) slot_ref[s] = 1;
+            continue;
+        }
+
+        // miss: take a free slot or pick a victim
+        if (used < cap) {
+            s = (int)used++;
+        } else if (policy == POL_LRU) {
+            s = lru_tail;
+            lru_unlink(s);
+            sim_unhash(s);
+        } else if (policy == POL_FIFO) {
+            s = (int)hand;
+            hand = (hand + 1) % cap;
+            sim_unhash(s);
+        } else {
+            while (slot_ref[hand]) { slot_ref[hand] = 0; hand = (hand + 1) % cap; }
+            s = (int)hand;
+            hand = (hand + 1) % cap;
+            sim_unhash(s);
+        }
+        slot_blk[s] = blk;
+        slot_ref[s] = 0;
+        sim_hash(s);
+        if (policy == POL_LRU) lru_push_front(s);
+    }
+    sim_free();
+    return hits;
+}
+
+// print usage
+static void help(void) {
+    printf("Usage : ssu_trace <TRACE> [-s SIZES] [-k KINDS] [-c CMD]\n");
+    printf("  -s SIZES : cache sizes in blocks, comma separated (default %s)\n", DEFAULT_SIZES);
+    printf("  -k KINDS : dir, inode, indirect, data, meta or all (default %s)\n", DEFAULT_KINDS);
+    printf("  -c CMD   : only accesses issued by CMD\n");
+}
+
+// main: summarize a block access trace and replay it against simulated caches
+int main(int argc, char *argv[]) {
+    const char *sizes_arg = DEFAULT_SIZES, *kinds_arg = DEFAULT_KINDS, *cmd_arg = NULL;
+
+    if (argc < 2) { help(); return EXIT_FAILURE; }
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-s") == 0) sizes_arg = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-k") == 0) kinds_arg = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "-c") == 0) cmd_arg = argv[++i];
+        else { help(); return EXIT_FAILURE; }
+    }
+
+    uint32_t sizes[MAX_SIZES];
+    int nsizes, kind_mask;
+    if ((nsizes = parse_sizes(sizes_arg, sizes)) < 0 || parse_kinds(kinds_arg, &kind_mask) < 0)
+        return EXIT_FAILURE;
+
+    // the command filter needs the names stored in the trace
+    FILE *fp = fopen(argv[1], "rb");
+    trace_header h;
+    int cmd = -1;
+    if (fp && cmd_arg && fread(&h, sizeof(h), 1, fp) == 1) {
+        char name[TRACE_NAME_LEN];
+        for (int i = 0; i < h.ncmds && fread(name, TRACE_NAME_LEN, 1, fp) == 1; i++) {
+            name[TRACE_NAME_LEN - 1] = '\0';
+            if (strcmp(name, cmd_arg) == 0) { cmd = i; break; }
+        }
+        if (cmd < 0) {
+            fprintf(stderr, "Error: '%s' does not appear in the trace's commands\n", cmd_arg);
+            fclose(fp);
+            return EXIT_FAILURE;
+        }
+    }
+    if (fp) fclose(fp);
+    if (load_trace(argv[1], (uint32_t)kind_mask, cmd) < 0) return EXIT_FAILURE;
+
+    // what was recorded
+    printf("trace       : %s (block size %" PRIu32 ", %" PRIu32 " blocks, %.3f s)\n",
+           argv[1], hdr.block_size, hdr.blocks_count, last_ns / 1e9);
+    printf("\n%-10s %12s %12s\n", "kind", "accesses", "blocks");
+    for (int k = 0; k < TRACE_KINDS; k++)
+        if (recs_by_kind[k])
+            printf("%-10s %12" PRIu64 " %12" PRIu64 "\n", kind_names[k], recs_by_kind[k], blocks_by_kind[k]);
+    printf("\n%-10s %12s %12s\n", "command", "accesses", "blocks");
+    for (int c = 0; c < hdr.ncmds; c++)
+        if (recs_by_cmd[c])
+            printf("%-10s %12" PRIu64 " %12" PRIu64 "\n", cmd_names[c], recs_by_cmd[c], blocks_by_cmd[c]);
+
+    // distinct blocks bound every cache: the first touch always misses
+    uint64_t distinct = 0;
+    uint8_t *seen = calloc(((uint64_t)hdr.blocks_count + 7) / 8 + 1, 1);
+    if (!seen) { perror("calloc"); return EXIT_FAILURE; }
+    for (uint64_t i = 0; i < nrefs; i++) {
+        uint32_t b = refs[i];
+        if (b >= hdr.blocks_count) { distinct++; continue; }
+        if (!(seen[b / 8] & (1 << (b % 8)))) { seen[b / 8] |= 1 << (b % 8); distinct++; }
+    }
+    free(seen);
+
+    printf("\nreplayed    : %" PRIu64 " block references (%s%s%s), %" PRIu64 " distinct\n",
+           nrefs, kinds_arg, cmd_arg ? ", " : "", cmd_arg ? cmd_arg : "", distinct);
+    if (nrefs == 0) { printf("\n"); return EXIT_SUCCESS; }
+    printf("\n%10s %10s", "blocks", "KiB");
+    for (int p = 0; p < POL_COUNT; p++) printf(" %8s", policy_names[p]);
+    printf("\n");
+    for (int i = 0; i < nsizes; i++) {
+        printf("%10" PRIu32 " %10" PRIu64, sizes[i], (uint64_t)sizes[i] * hdr.block_size / 1024);
+        for (int p = 0; p < POL_COUNT; p++)
+            printf(" %7.2f%%", 100.0 * run_policy(p, sizes[i]) / nrefs);
+        printf("\n");
+    }
+    printf("%10s %10s %7.2f%%  (every re-reference hits)\n\n", "infinite", "-",
+           100.0 * (nrefs - distinct) / nrefs);
+
+    free(refs);
+    free(cmd_names);
+    free(recs_by_cmd);
+    free(blocks_by_cmd);
+    return EXIT_SUCCESS;
+}
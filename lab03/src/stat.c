@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <time.h>
+#include "header.h"
+
+/* -- Prototypes -- */
+static const char *type_name(uint16_t mode);
+static void format_mode(uint16_t mode, char *buf);
+static void format_time(uint32_t t, char *buf, size_t len);
+static void help(void);
+
+// type_name: human readable file type
+static const char *type_name(uint16_t mode) {
+    if (S_ISREG(mode)) return "regular file";
+    if (S_ISDIR(mode)) return "directory";
+    if (S_ISLNK(mode)) return "symbolic link";
+    if (S_ISCHR(mode)) return "character special file";
+    if (S_ISBLK(mode)) return "block special file";
+    if (S_ISFIFO(mode)) return "fifo";
+    if (S_ISSOCK(mode)) return "socket";
+    return "unknown";
+}
+
+// format_mode: ls-style type and permission string
+static void format_mode(uint16_t mode, char *buf) {
+    buf[0] = S_ISDIR(mode) ? 'd' : S_ISLNK(mode) ? 'l' : S_ISCHR(mode) ? 'c'
+           : S_ISBLK(mode) ? 'b' : S_ISFIFO(mode) ? 'p' : S_ISSOCK(mode) ? 's' : '-';
+    const char *perm = "rwxrwxrwx";
+    for (int i = 0; i < 9; i++) buf[i+1] = (mode & (1 << (8 - i))) ? perm[i] : '-';
+    buf[10] = '\0';
+}
+
+// format_time: local time of an on-disk timestamp
+static void format_time(uint32_t t, char *buf, size_t len) {
+    time_t tt = (time_t)t;
+    struct tm tm;
+    if (!localtime_r(&tt, &tm) || !strftime(buf, len, "%Y-%m-%d %H:%M:%S %z", &tm))
+        snprintf(buf, len, "%" PRIu32, t);
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : stat <PATH>\n");
+}
+
+// cmd_stat: entry point for stat command
+void cmd_stat(int argc, char *argv[]) {
+    if (argc != 2) { help(); return; }
+    const char *path = argv[1];
+
+    // validate path
+    ext2_inode inode;
+    int ino = get_inode_by_path(path, &inode);
+    if (ino < 0) { help(); return; }
+
+    char mode[16], atime[64], mtime[64], chtime[64];
+    format_mode(inode.i_mode, mode);
+    format_time(inode.i_atime, atime, sizeof(atime));
+    format_time(inode.i_mtime, mtime, sizeof(mtime));
+    format_time(inode.i_ctime, chtime, sizeof(chtime));
+
+    fprintf(OUT, "  File: %s\n", path);
+    fprintf(OUT, "  Size: %-12" PRIu64 " Blocks: %-10" PRIu32 " IO Block: %-6d %s\n",
+            inode_size64(&inode), inode.i_blocks, block_size, type_name(inode.i_mode));
+    fprintf(OUT, " Inode: %-12d Links: %" PRIu16 "\n", ino, inode.i_links_count);
+    fprintf(OUT, "Access: (%04o/%s)  Uid: %5" PRIu16 "   Gid: %5" PRIu16 "\n",
+            inode.i_mode & 07777, mode, inode.i_uid, inode.i_gid);
+    fprintf(OUT, "Access: %s\n", atime);
+    fprintf(OUT, "Modify: %s\n", mtime);
+    fprintf(OUT, "Change: %s\n\n", chtime);
+    fflush(OUT);
+}
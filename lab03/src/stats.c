@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "header.h"
+
+#define MAX_STAT_CMDS 16
+
+/* -- Prototypes -- */
+static void help(void);
+static void print_stats(void);
+
+/* -- Per-command wall time -- */
+typedef struct {
+    char name[16];
+    uint64_t calls;
+    double total;      // seconds
+    double max;        // seconds
+} CommandTime;
+
+io_counters io_stats;
+static CommandTime cmd_times[MAX_STAT_CMDS];
+static int cmd_time_count = 0;
+
+// stats_record_command: accumulate wall time of one dispatched command
+void stats_record_command(const char *name, double seconds) {
+    CommandTime *ct = NULL;
+    for (int i = 0; i < cmd_time_count; i++) {
+        if (strcmp(cmd_times[i].name, name) == 0) { ct = &cmd_times[i]; break; }
+    }
+    if (!ct) {
+        if (cmd_time_count >= MAX_STAT_CMDS) return;
+        ct = &cmd_times[cmd_time_count++];
+        memset(ct, 0, sizeof(*ct));
+        snprintf(ct->name, sizeof(ct->name), "%s", name);
+    }
+    ct->calls++;
+    ct->total += seconds;
+    if (seconds > ct->max) ct->max = seconds;
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : stats [reset]\n");
+}
+
+// print_stats: dump I/O counters and per-command wall time
+static void print_stats(void) {
+    uint64_t lookups = io_stats.cache_hits + io_stats.cache_misses;
+
+    fprintf(OUT, "blocks read       : %" PRIu64 "\n", io_stats.blocks_read);
+    fprintf(OUT, "bytes read        : %" PRIu64 "\n", io_stats.bytes_read);
+    fprintf(OUT, "read syscalls     : %" PRIu64 "\n", io_stats.syscalls);
+    fprintf(OUT, "cache hits/misses : %" PRIu64 " / %" PRIu64 " (%.1f%% hit)\n",
+            io_stats.cache_hits, io_stats.cache_misses,
+            lookups ? 100.0 * io_stats.cache_hits / lookups : 0.0);
+    fprintf(OUT, "inode reads       : %" PRIu64 "\n", io_stats.inode_reads);
+    fprintf(OUT, "dir blocks parsed : %" PRIu64 "\n", io_stats.dir_blocks);
+    fprintf(OUT, "tree cache hits   : %" PRIu64 "\n", io_stats.tree_hits);
+    fprintf(OUT, "warmed blocks     : %" PRIu64 "\n", io_stats.warm_blocks);
+
+    if (cmd_time_count > 0) {
+        fprintf(OUT, "\n%-10s %8s %12s %12s %12s\n", "command", "calls", "total(ms)", "avg(ms)", "max(ms)");
+        for (int i = 0; i < cmd_time_count; i++) {
+            CommandTime *ct = &cmd_times[i];
+            fprintf(OUT, "%-10s %8" PRIu64 " %12.3f %12.3f %12.3f\n", ct->name, ct->calls,
+                    ct->total * 1e3, ct->total * 1e3 / ct->calls, ct->max * 1e3);
+        }
+    }
+    fprintf(OUT, "\n");
+}
+
+// cmd_stats: entry point for stats command
+void cmd_stats(int argc, char *argv[]) {
+    if (argc == 1) {
+        print_stats();
+    } else if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        memset(&io_stats, 0, sizeof(io_stats));
+        cmd_time_count = 0;
+    } else {
+        help();
+    }
+}
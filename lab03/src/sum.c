@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "header.h"
+
+#define SUM_CHUNK   (1 << 20)   // bytes per coalesced read
+#define SUM_THREADS 8           // upper bound on hashing workers
+
+/* -- Prototypes -- */
+static void add_file(const ext2_inode *inode, const char *path, void *arg);
+static int hash_inode(ext2_inode *inode, int alg, char *buf, char *hex);
+static void hash_job(int idx, char *buf, void *arg);
+static void clear_jobs(void);
+static void help(void);
+
+/* -- Hash job -- */
+typedef struct {
+    ext2_inode inode;
+    char *path;
+    char hex[65];
+    int failed;
+} SumJob;
+
+static SumJob *jobs = NULL;
+static int job_count = 0, job_cap = 0;
+static int job_alg = HASH_CRC32C;
+
+// clear_jobs: free the job list
+static void clear_jobs(void) {
+    for (int i = 0; i < job_count; i++) free(jobs[i].path);
+    free(jobs);
+    jobs = NULL;
+    job_count = job_cap = 0;
+}
+
+// add_file: walk_tree callback queueing every regular file in walk order
+static void add_file(const ext2_inode *inode, const char *path, void *arg) {
+    (void)arg;
+    if (!S_ISREG(inode->i_mode)) return;
+    if (job_count >= job_cap) {
+        job_cap = job_cap ? job_cap * 2 : 64;
+        jobs = realloc(jobs, job_cap * sizeof *jobs);
+        if (!jobs) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    memset(&jobs[job_count], 0, sizeof(jobs[job_count]));
+    jobs[job_count].inode = *inode;
+    jobs[job_count].path = strdup(path);
+    job_count++;
+}
+
+// hash_inode: feed file contents straight from the block iterator into the hash
+static int hash_inode(ext2_inode *inode, int alg, char *buf, char *hex) {
+    hash_ctx ctx;
+    block_iter it;
+    uint64_t lblk, remaining = inode_size64(inode);
+    uint32_t pblk, len;
+    int ret = 0;
+
+    hash_init(&ctx, alg);
+    biter_init(&it, inode);
+    while (remaining > 0 && biter_next(&it, &lblk, &pblk, &len, SUM_CHUNK / block_size) > 0) {
+        size_t run = (size_t)len * block_size;
+        size_t bytes = remaining < run ? (size_t)remaining : run;
+        // holes hash as zeros
+        if (!pblk) memset(buf, 0, bytes);
+        else if (read_blocks(pblk, len, buf) < 0) { ret = -1; break; }
+        hash_update(&ctx, buf, bytes);
+        remaining -= bytes;
+    }
+    biter_free(&it);
+    hash_final(&ctx, hex);
+    return ret;
+}
+
+// hash_job: run_jobs callback hashing one queued file
+static void hash_job(int idx, char *buf, void *arg) {
+    (void)arg;
+    SumJob *job = &jobs[idx];
+    job->failed = hash_inode(&job->inode, job_alg, buf, job->hex) < 0;
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : sum <PATH> [-a crc32c|xxh64|sha256] [-r]\n");
+}
+
+// cmd_sum: entry point for sum command
+void cmd_sum(int argc, char *argv[]) {
+    int recursive = 0, alg = HASH_CRC32C;
+
+    if (argc < 2) { help(); return; }
+    const char *path = argv[1];
+    // parse options
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0) {
+            recursive = 1;
+        } else if (strcmp(argv[i], "-a") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(ERR, "sum: option requires an argument -- 'a'\n");
+                return;
+            }
+            if ((alg = hash_by_name(argv[++i])) < 0) { help(); return; }
+        } else {
+            help();
+            return;
+        }
+    }
+
+    // validate path
+    ext2_inode inode;
+    if (get_inode_by_path(path, &inode) < 0) { help(); return; }
+    if (is_dir(&inode) && !recursive) {
+        fprintf(ERR, "Error: '%s' is not file\n", path);
+        return;
+    }
+
+    clear_jobs();
+    job_alg = alg;
+    walk_tree(&inode, path, add_file, NULL);
+
+    // Hash files in parallel, print in walk order
+    run_jobs(job_count, SUM_THREADS, SUM_CHUNK, hash_job, NULL);
+
+    for (int i = 0; i < job_count; i++) {
+        if (jobs[i].failed) fprintf(ERR, "sum: %s: read error\n", jobs[i].path);
+        else fprintf(OUT, "%s  %s\n", jobs[i].hex, jobs[i].path);
+    }
+    clear_jobs();
+}
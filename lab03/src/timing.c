@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "header.h"
+
+#define MAX_TIMED_CMDS 16
+#define HIST_SUB       4                     // sub-buckets per power of two
+#define HIST_BUCKETS   (40 * HIST_SUB)       // covers up to 2^40 us
+
+/* -- Prototypes -- */
+static int bucket_of(uint64_t us);
+static uint64_t bucket_upper(int idx);
+static uint64_t percentile(const uint64_t *hist, uint64_t count, double p);
+static double tv_ms(struct timeval tv);
+static void print_summary(void);
+static void help(void);
+
+/* -- Latency histogram per command (microseconds, log-linear buckets) -- */
+typedef struct {
+    char name[16];
+    uint64_t count;
+    uint64_t min_us, max_us;
+    uint64_t hist[HIST_BUCKETS];
+} LatencyHist;
+
+static LatencyHist hists[MAX_TIMED_CMDS];
+static int hist_count = 0;
+
+// bucket_of: 4 buckets per octave, exact below HIST_SUB
+static int bucket_of(uint64_t us) {
+    if (us < HIST_SUB) return (int)us;
+    int msb = 63 - __builtin_clzll(us);
+    int sub = (int)((us >> (msb - 2)) & (HIST_SUB - 1));
+    int idx = (msb - 1) * HIST_SUB + sub;
+    return idx < HIST_BUCKETS ? idx : HIST_BUCKETS - 1;
+}
+
+// bucket_upper: largest latency that falls into bucket idx
+static uint64_t bucket_upper(int idx) {
+    if (idx < HIST_SUB) return (uint64_t)idx;
+    int msb = idx / HIST_SUB + 1;
+    uint64_t lower = (uint64_t)(HIST_SUB + idx % HIST_SUB) << (msb - 2);
+    return lower + ((uint64_t)1 << (msb - 2)) - 1;
+}
+
+// percentile: upper bound of the bucket holding the p-th sample
+static uint64_t percentile(const uint64_t *hist, uint64_t count, double p) {
+    uint64_t rank = (uint64_t)(p * count + 0.999999);
+    uint64_t seen = 0;
+    if (rank == 0) rank = 1;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen >= rank) return bucket_upper(i);
+    }
+    return bucket_upper(HIST_BUCKETS - 1);
+}
+
+// timing_record: add one latency sample for a command
+void timing_record(const char *name, double seconds) {
+    LatencyHist *h = NULL;
+    for (int i = 0; i < hist_count; i++) {
+        if (strcmp(hists[i].name, name) == 0) { h = &hists[i]; break; }
+    }
+    if (!h) {
+        if (hist_count >= MAX_TIMED_CMDS) return;
+        h = &hists[hist_count++];
+        memset(h, 0, sizeof(*h));
+        snprintf(h->name, sizeof(h->name), "%s", name);
+        h->min_us = UINT64_MAX;
+    }
+    uint64_t us = (uint64_t)(seconds * 1e6);
+    h->count++;
+    h->hist[bucket_of(us)]++;
+    if (us < h->min_us) h->min_us = us;
+    if (us > h->max_us) h->max_us = us;
+}
+
+static double tv_ms(struct timeval tv) {
+    return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+// print_summary: p50 / p99 per command over the session
+static void print_summary(void) {
+    fprintf(OUT, "%-10s %8s %12s %12s %12s %12s\n",
+            "command", "count", "min(ms)", "p50(ms)", "p99(ms)", "max(ms)");
+    for (int i = 0; i < hist_count; i++) {
+        LatencyHist *h = &hists[i];
+        uint64_t p50 = percentile(h->hist, h->count, 0.50);
+        uint64_t p99 = percentile(h->hist, h->count, 0.99);
+        // bucket bounds never exceed what was actually observed
+        if (p50 > h->max_us) p50 = h->max_us;
+        if (p99 > h->max_us) p99 = h->max_us;
+        fprintf(OUT, "%-10s %8" PRIu64 " %12.3f %12.3f %12.3f %12.3f\n", h->name, h->count,
+                h->min_us / 1e3, p50 / 1e3, p99 / 1e3, h->max_us / 1e3);
+    }
+    fprintf(OUT, "\n");
+}
+
+// print usage
+static void help(void) {
+    fprintf(OUT, "Usage : time <COMMAND> [ARG]... | time summary\n");
+}
+
+// cmd_time: run a command and report its wall/cpu time and page faults
+int cmd_time(int argc, char *argv[]) {
+    if (argc < 2) { help(); return 0; }
+    if (strcmp(argv[1], "summary") == 0) {
+        if (argc != 2) { help(); return 0; }
+        print_summary();
+        return 0;
+    }
+
+    struct rusage ru0, ru1;
+    struct timespec t0, t1;
+    getrusage(RUSAGE_SELF, &ru0);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int quit = run_command(argc - 1, argv + 1);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    getrusage(RUSAGE_SELF, &ru1);
+
+    double real = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    fflush(OUT);
+    fprintf(ERR, "real %.3f ms  user %.3f ms  sys %.3f ms  major faults %ld  minor faults %ld\n",
+            real, tv_ms(ru1.ru_utime) - tv_ms(ru0.ru_utime),
+            tv_ms(ru1.ru_stime) - tv_ms(ru0.ru_stime),
+            ru1.ru_majflt - ru0.ru_majflt, ru1.ru_minflt - ru0.ru_minflt);
+    return quit;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "header.h"
+
+#define TRACE_BUF_RECS 4096   // records buffered between writes
+
+/* -- Prototypes -- */
+static uint64_t now_ns(void);
+static int trace_flush(void);
+
+/* -- Commands a trace can attribute accesses to (index 0 = anything else) -- */
+static const char *trace_cmds[] = {
+    "other", "tree", "print", "extract", "sum", "grep", "find", "stat", "check", "time", "export", "owner", "warm", "dump-meta",
+};
+#define TRACE_NCMDS ((int)(sizeof(trace_cmds) / sizeof(trace_cmds[0])))
+
+int tracing = 0;
+static FILE *trace_fp = NULL;
+static trace_rec trace_buf[TRACE_BUF_RECS];
+static int trace_used = 0;
+static uint64_t trace_start;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// issuing command: per thread for server workers, else the one the shell runs
+static int cmd_global = 0;
+static __thread int cmd_local = -1;
+
+// now_ns: monotonic clock in nanoseconds
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// trace_flush: write out buffered records (trace_lock held)
+static int trace_flush(void) {
+    if (trace_used > 0 && fwrite(trace_buf, sizeof(trace_rec), trace_used, trace_fp) != (size_t)trace_used) {
+        fprintf(stderr, "Error: trace file write failed, tracing stopped\n");
+        tracing = 0;
+        trace_used = 0;
+        return -1;
+    }
+    trace_used = 0;
+    return 0;
+}
+
+// trace_open: start recording block accesses of the opened image to 'path'
+int trace_open(const char *path) {
+    trace_fp = fopen(path, "wb");
+    if (!trace_fp) {
+        fprintf(stderr, "Error: '%s' cannot create trace file\n", path);
+        return -1;
+    }
+
+    trace_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TRACE_MAGIC, 4);
+    h.version = TRACE_VERSION;
+    h.ncmds = TRACE_NCMDS;
+    h.block_size = (uint32_t)block_size;
+    h.blocks_count = sb.s_blocks_count;
+    int ok = fwrite(&h, sizeof(h), 1, trace_fp) == 1;
+    for (int i = 0; ok && i < TRACE_NCMDS; i++) {
+        char name[TRACE_NAME_LEN] = {0};
+        strncpy(name, trace_cmds[i], TRACE_NAME_LEN - 1);
+        ok = fwrite(name, TRACE_NAME_LEN, 1, trace_fp) == 1;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: '%s' cannot write trace file\n", path);
+        fclose(trace_fp);
+        trace_fp = NULL;
+        return -1;
+    }
+    trace_start = now_ns();
+    tracing = 1;
+    return 0;
+}
+
+// trace_command: attribute following accesses to command 'name'
+// (this_thread: only for the calling thread, as server workers do)
+void trace_command(const char *name, int this_thread) {
+    int id = 0;
+    for (int i = 1; i < TRACE_NCMDS; i++)
+        if (strcmp(trace_cmds[i], name) == 0) { id = i; break; }
+    if (this_thread) cmd_local = id;
+    else cmd_global = id;
+}
+
+// trace_access: record one physical access of 'count' blocks from 'blk'
+void trace_access(uint32_t blk, uint32_t count, int kind) {
+    uint64_t ns = now_ns() - trace_start;
+    int cmd = cmd_local >= 0 ? cmd_local : cmd_global;
+
+    pthread_mutex_lock(&trace_lock);
+    // long runs are split so the 16-bit count never wraps
+    while (tracing && count > 0) {
+        uint32_t n = count > UINT16_MAX ? UINT16_MAX : count;
+        trace_rec *r = &trace_buf[trace_used++];
+        r->blk = blk;
+        r->count = (uint16_t)n;
+        r->kind = (uint8_t)kind;
+        r->cmd = (uint8_t)cmd;
+        r->ns = ns;
+        blk += n;
+        count -= n;
+        if (trace_used == TRACE_BUF_RECS) trace_flush();
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// trace_close: flush and close the trace file
+void trace_close(void) {
+    if (!trace_fp) return;
+    pthread_mutex_lock(&trace_lock);
+    trace_flush();
+    tracing = 0;
+    pthread_mutex_unlock(&trace_lock);
+    fclose(trace_fp);
+    trace_fp = NULL;
+}
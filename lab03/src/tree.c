@@ -1,18 +1,10 @@
 #include <stdio.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include "header.h"
 
-/* -- Prototypes -- */
-static void add_node(const char *name, int depth, int is_last, ext2_inode *inode);
-static void clear_tree_list(void);
-static void build_tree(const char *path, int depth, int recursive);
-static void print_nodes(int show_size, int show_perm);
-static int is_dir(ext2_inode *inode);
-static int read_block(int blk, void *buf);
-static int read_inode(int ino, ext2_inode *buf);
-static int get_inode_by_path(const char *path, ext2_inode *inode);
-static void format_permissions(uint16_t mode, char *buf);
-static void format_size(uint32_t size, char *buf);
-static void help(void);
+#define TREE_CACHE_ENTRIES 4096        // cached subtrees (one per directory walked)
+#define TREE_CACHE_NODES   (1 << 20)   // nodes kept across all cached lists
 
 /* -- Tree node -- */
 typedef struct TreeNode {
@@ -20,210 +12,274 @@ typedef struct TreeNode {
     int depth;
     int is_last;
     ext2_inode inode;
-    struct TreeNode *next;
 } TreeNode;
 
-static TreeNode *list_head = NULL;
-static TreeNode *list_tail = NULL;
+// Nodes built by one request, shared read-only once cached
+typedef struct NodeList {
+    TreeNode *v;
+    int count, cap;
+    int refs;                 // cache entries and readers using it
+} NodeList;
+
+// Cached subtree: nodes [start, start+count) of a list, depths offset by base.
+// The image is read-only for the session; the directory's times and size
+// guard against another image reusing the inode number.
+typedef struct TreeEntry {
+    uint32_t ino;
+    int recursive;
+    uint32_t mtime, ctime, size;
+    NodeList *list;           // NULL for a free slot
+    int start, count, base;
+    int hnext;                // hash chain
+    int prev, next;           // LRU order, most recent at lru_head
+} TreeEntry;
+
+// Subtree walked while building, cached along with the request
+typedef struct Pending {
+    uint32_t ino;
+    ext2_inode inode;
+    int recursive;
+    int start, count, base;
+} Pending;
+typedef struct { Pending *v; int count, cap; } PendingList;
+
+/* -- Prototypes -- */
+static void add_node(NodeList *list, const char *name, int depth, int is_last, const ext2_inode *inode);
+static void list_release(NodeList *list);
+static TreeEntry *cache_find(uint32_t ino, const ext2_inode *dir, int recursive);
+static int *bucket_of(uint32_t ino);
+static void lru_unlink(int i);
+static void lru_push(int i);
+static void entry_drop(int i);
+static void cache_store(NodeList *list, const PendingList *pend);
+static void add_pending(PendingList *pend, const Pending *p);
+static void build_tree(const ext2_inode *dir_inode, int depth, int recursive,
+                       NodeList *out, PendingList *pend);
+static void print_nodes(const TreeNode *nodes, int count, int base, int top_only,
+                        int show_size, int show_perm);
+static void format_permissions(uint16_t mode, char *buf);
+static void format_size(uint64_t size, char *buf);
+static void help(void);
+
+/* -- Subtree cache (shared by server threads) -- */
+static TreeEntry tree_cache[TREE_CACHE_ENTRIES];
+static int tree_buckets[TREE_CACHE_ENTRIES];
+static int tree_free[TREE_CACHE_ENTRIES], nfree = -1;    // -1 until first use
+static int lru_head = -1, lru_tail = -1;
+static long tree_cached_nodes = 0;
+static pthread_mutex_t tree_lock = PTHREAD_MUTEX_INITIALIZER;
 
-// add_node: append a node to the linked list
-static void add_node(const char *name, int depth, int is_last, ext2_inode *inode) {
-    TreeNode *node = malloc(sizeof(TreeNode));
-    if (!node) { perror("malloc"); exit(EXIT_FAILURE); }
+// add_node: append a node to the list
+static void add_node(NodeList *list, const char *name, int depth, int is_last, const ext2_inode *inode) {
+    if (list->count >= list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 64;
+        list->v = realloc(list->v, list->cap * sizeof *list->v);
+        if (!list->v) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    TreeNode *node = &list->v[list->count++];
     node->name = strdup(name);
+    if (!node->name) { perror("strdup"); exit(EXIT_FAILURE); }
     node->depth = depth;
     node->is_last = is_last;
     node->inode = *inode;
-    node->next = NULL;
-    if (!list_head) list_head = node;
-    else list_tail->next = node;
-    list_tail = node;
 }
 
-// clear_tree_list: free all nodes
-static void clear_tree_list(void) {
-    TreeNode *cur = list_head;
-    while (cur) {
-        TreeNode *next = cur->next;
-        free(cur->name);
-        free(cur);
-        cur = next;
-    }
-    list_head = list_tail = NULL;
+// list_release: drop a reference, freeing all nodes with the last one (tree_lock held)
+static void list_release(NodeList *list) {
+    if (--list->refs > 0) return;
+    for (int i = 0; i < list->count; i++) free(list->v[i].name);
+    tree_cached_nodes -= list->count;
+    free(list->v);
+    free(list);
+}
+
+static int *bucket_of(uint32_t ino) {
+    return &tree_buckets[(ino * 2654435761u) % TREE_CACHE_ENTRIES];
 }
 
-// build_tree: scan directory entries and recurse
-static void build_tree(const char *path, int depth, int recursive) {
-    ext2_inode dir_inode;
-    // Retrieve inode and verify directory
-    if (get_inode_by_path(path, &dir_inode) < 0 || !is_dir(&dir_inode))
-        return;
+static void lru_unlink(int i) {
+    TreeEntry *e = &tree_cache[i];
+    if (e->prev >= 0) tree_cache[e->prev].next = e->next; else lru_head = e->next;
+    if (e->next >= 0) tree_cache[e->next].prev = e->prev; else lru_tail = e->prev;
+}
 
-    int blocks = (dir_inode.i_size + block_size - 1) / block_size;
-    char *buf = malloc(block_size);
-    if (!buf) { perror("malloc"); return; }
+static void lru_push(int i) {
+    tree_cache[i].prev = -1;
+    tree_cache[i].next = lru_head;
+    if (lru_head >= 0) tree_cache[lru_head].prev = i;
+    lru_head = i;
+    if (lru_tail < 0) lru_tail = i;
+}
 
-    // Collect directory entries except '.' '..' and 'lost+found'
-    typedef struct { uint32_t ino; char name[EXT2_NAME_LEN+1]; } DirEntry;
-    DirEntry *entries = NULL;
-    int count = 0, cap = 0;
-
-    for (int i = 0; i < blocks; i++) {
-        uint32_t blk = dir_inode.i_block[i];
-        if (!blk) continue;
-        if (read_block(blk, buf) < 0) continue;
-        int off = 0;
-        while (off < block_size) {
-            ext2_dir_entry_2 *e = (ext2_dir_entry_2*)(buf + off);
-            if (e->inode) {
-                char name[EXT2_NAME_LEN+1] = {0};
-                memcpy(name, e->name, e->name_len);
-                // Skip special entries
-                if (strcmp(name, ".") && strcmp(name, "..") && strcmp(name, "lost+found")) {
-                    if (count >= cap) {
-                        cap = cap ? cap * 2 : 8;
-                        entries = realloc(entries, cap * sizeof *entries);
-                        if (!entries) { perror("realloc"); exit(EXIT_FAILURE); }
-                    }
-                    entries[count].ino = e->inode;
-                    strncpy(entries[count].name, name, EXT2_NAME_LEN);
-                    count++;
-                }
-            }
-            off += e->rec_len;
+// entry_drop: unhash and unlink an entry, releasing its list (tree_lock held)
+static void entry_drop(int i) {
+    TreeEntry *e = &tree_cache[i];
+    int *p = bucket_of(e->ino);
+    while (*p != i) p = &tree_cache[*p].hnext;
+    *p = e->hnext;
+    lru_unlink(i);
+    list_release(e->list);
+    e->list = NULL;
+    tree_free[nfree++] = i;
+}
+
+// cache_find: entry for a directory in its current state (tree_lock held)
+static TreeEntry *cache_find(uint32_t ino, const ext2_inode *dir, int recursive) {
+    if (nfree < 0) return NULL;
+    for (int i = *bucket_of(ino); i >= 0; i = tree_cache[i].hnext) {
+        TreeEntry *e = &tree_cache[i];
+        if (e->ino == ino && e->recursive == recursive && e->mtime == dir->i_mtime
+            && e->ctime == dir->i_ctime && e->size == dir->i_size) {
+            lru_unlink(i);
+            lru_push(i);
+            return e;
         }
     }
-    free(buf);
+    return NULL;
+}
+
+// cache_store: publish a built list with an entry per walked subtree, evicting
+// least recently used entries for slots and the node budget (tree_lock held)
+static void cache_store(NodeList *list, const PendingList *pend) {
+    if (nfree < 0) {
+        memset(tree_buckets, -1, sizeof(tree_buckets));
+        for (nfree = 0; nfree < TREE_CACHE_ENTRIES; nfree++) tree_free[nfree] = TREE_CACHE_ENTRIES - 1 - nfree;
+    }
+    list->refs++;    // pin while entries are added
+    tree_cached_nodes += list->count;
+    for (int k = 0; k < pend->count; k++) {
+        const Pending *p = &pend->v[k];
+        // replace an older copy of this subtree, else take a free slot or the LRU one
+        int slot = -1;
+        for (int i = *bucket_of(p->ino); i >= 0; i = tree_cache[i].hnext)
+            if (tree_cache[i].ino == p->ino && tree_cache[i].recursive == p->recursive) { slot = i; break; }
+        if (slot >= 0) entry_drop(slot);
+        else if (nfree == 0) entry_drop(lru_tail);
+        slot = tree_free[--nfree];
+
+        TreeEntry *e = &tree_cache[slot];
+        *e = (TreeEntry){ p->ino, p->recursive, p->inode.i_mtime, p->inode.i_ctime,
+                          p->inode.i_size, list, p->start, p->count, p->base, -1, -1, -1 };
+        int *b = bucket_of(p->ino);
+        e->hnext = *b;
+        *b = slot;
+        lru_push(slot);
+        list->refs++;
+    }
+    list_release(list);
+
+    // over the node budget: drop the oldest entries until their lists go
+    while (tree_cached_nodes > TREE_CACHE_NODES && lru_tail >= 0)
+        entry_drop(lru_tail);
+}
+
+// add_pending: remember a walked subtree for cache_store
+static void add_pending(PendingList *pend, const Pending *p) {
+    if (pend->count >= pend->cap) {
+        pend->cap = pend->cap ? pend->cap * 2 : 16;
+        pend->v = realloc(pend->v, pend->cap * sizeof *pend->v);
+        if (!pend->v) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    pend->v[pend->count++] = *p;
+}
+
+// build_tree: scan directory entries into 'out' and recurse; cached subdirectories
+// are copied in, the ones walked here are recorded in 'pend'
+static void build_tree(const ext2_inode *dir_inode, int depth, int recursive,
+                       NodeList *out, PendingList *pend) {
+    // Collect directory entries except '.' '..' and 'lost+found'
+    dir_child_list list;
+    dir_children(dir_inode, &list);
+    dir_child *entries = list.v;
+    int count = list.count;
+
+    // Fetch all child inodes in one batch
+    uint32_t *inos = malloc((count ? count : 1) * sizeof *inos);
+    ext2_inode *children = malloc((count ? count : 1) * sizeof *children);
+    if (!inos || !children) { perror("malloc"); exit(EXIT_FAILURE); }
+    for (int i = 0; i < count; i++) inos[i] = entries[i].ino;
+    read_inodes(inos, count, children);
+    free(inos);
+
     // Add each entry to node list and recurse if needed
     for (int i = 0; i < count; i++) {
-        ext2_inode child;
-        read_inode(entries[i].ino, &child);
-        int last = (i == count - 1);
-        add_node(entries[i].name, depth, last, &child);
-        if (recursive && is_dir(&child)) {
-            char subpath[1024];
-            snprintf(subpath, sizeof(subpath), "%s/%s", path, entries[i].name);
-            build_tree(subpath, depth + 1, recursive);
+        const ext2_inode *child = &children[i];
+        add_node(out, entries[i].name, depth, i == count - 1, child);
+        if (!recursive || !is_dir(child)) continue;
+
+        // reuse an earlier request's walk of this directory
+        pthread_mutex_lock(&tree_lock);
+        TreeEntry *e = cache_find(entries[i].ino, child, 1);
+        TreeEntry hit = e ? *e : (TreeEntry){ 0 };
+        if (e) e->list->refs++;
+        pthread_mutex_unlock(&tree_lock);
+        if (e) {
+            STAT_ADD(tree_hits, 1);
+            for (const TreeNode *n = hit.list->v + hit.start; n < hit.list->v + hit.start + hit.count; n++)
+                add_node(out, n->name, n->depth - hit.base + depth + 1, n->is_last, &n->inode);
+            pthread_mutex_lock(&tree_lock);
+            list_release(hit.list);
+            pthread_mutex_unlock(&tree_lock);
+            continue;
         }
+
+        int first = out->count;
+        build_tree(child, depth + 1, recursive, out, pend);
+        add_pending(pend, &(Pending){ entries[i].ino, *child, 1, first, out->count - first, depth + 1 });
     }
 
+    free(children);
     free(entries);
 }
 
-// print_nodes: Iterate the node list and print a tree-like layout.
-static void print_nodes(int show_size, int show_perm) {
-    int last_flags[MAX_ARG] = {0};
+// print_nodes: Iterate the nodes and print a tree-like layout
+// (top_only: first level only, when a recursive list answers a plain request)
+static void print_nodes(const TreeNode *nodes, int count, int base, int top_only,
+                        int show_size, int show_perm) {
+    int last_flags[MAX_PATH / 2] = {0};
+    const int max_depth = (int)(sizeof(last_flags) / sizeof(last_flags[0]));
 
-    for (TreeNode *cur = list_head; cur; cur = cur->next) {
+    for (const TreeNode *cur = nodes; cur < nodes + count; cur++) {
+        int depth = cur->depth - base;
+        if (top_only && depth > 0) continue;
         // Print tree branches based on depth
-        for (int level = 0; level < cur->depth; level++) {
-            if (last_flags[level])
-                printf("    ");
+        for (int level = 0; level < depth; level++) {
+            if (level < max_depth && last_flags[level])
+                fprintf(OUT, "    ");
             else
-                printf("│   ");
+                fprintf(OUT, "│   ");
         }
         // Print the branch symbol
-        printf(cur->is_last ? "└── " : "├── ");
+        fprintf(OUT, cur->is_last ? "└── " : "├── ");
 
         // Print permissions and size if requested
         if (show_perm || show_size) {
-            printf("[");
+            fprintf(OUT, "[");
             if (show_perm) {
                 char p[16];
                 format_permissions(cur->inode.i_mode, p);
-                printf("%s", p);
+                fprintf(OUT, "%s", p);
             }
-            if (show_perm && show_size) printf(" ");
+            if (show_perm && show_size) fprintf(OUT, " ");
             if (show_size) {
-                char s[16];
-                format_size(cur->inode.i_size, s);
-                printf("%s", s);
+                char s[24];
+                format_size(inode_size64(&cur->inode), s);
+                fprintf(OUT, "%s", s);
             }
-            printf("] ");
+            fprintf(OUT, "] ");
         }
 
         // Print the entry name
-        printf("%s\n", cur->name);
+        fprintf(OUT, "%s\n", cur->name);
 
         // Mark this level as last for indentation logic
-        last_flags[cur->depth] = cur->is_last;
+        if (depth < max_depth) last_flags[depth] = cur->is_last;
     }
 }
 
 // print usage
 static void help() {
-	printf("Usage : tree <PATH> [OPTION]...\n");
-}
-
-// is_dir: check inode mode for directory
-static int is_dir(ext2_inode *inode) {
-    return (inode->i_mode & EXT2_S_IFDIR) == EXT2_S_IFDIR;
-}
-
-// read_block: read a block from disk image
-static int read_block(int blk, void *buf) {
-    off_t off = (off_t)blk * block_size;
-    if (lseek(fs_fd, off, SEEK_SET) < 0) return -1;
-    return read(fs_fd, buf, block_size) == block_size ? 0 : -1;
-}
-
-// read_inode: read inode from table
-static int read_inode(int ino, ext2_inode *buf) {
-    off_t base = (off_t)gd.bg_inode_table * block_size;
-    off_t off = base + (ino - 1) * inode_size;
-    if (lseek(fs_fd, off, SEEK_SET) < 0) return -1;
-    return read(fs_fd, buf, inode_size) == inode_size ? 0 : -1;
-}
-
-// get_inode_by_path: resolve path to inode
-static int get_inode_by_path(const char *path, ext2_inode *inode) {
-    // Handle root or current directory
-	if (strcmp(path, ".") == 0 || strcmp(path, "/") == 0) {
-		ext2_inode root;
-        if (read_inode(2, &root) < 0) return -1;
-        *inode = root;
-        return 2;
-    }
-
-	char *copy = strdup(path);
-    if (!copy) return -1;
-    int cur_ino = 2;
-    ext2_inode cur;
-    if (read_inode(cur_ino, &cur) < 0) { free(copy); return -1; }
-    char *tok = strtok(copy, "/");
-    // Traverse each component
-    while (tok) {
-        if (!S_ISDIR(cur.i_mode)) break;
-        int blocks = (cur.i_size + block_size - 1) / block_size;
-        char *buf = malloc(block_size);
-        int found = 0;
-        for (int i = 0; i < blocks && !found; i++) {
-            uint32_t blk = cur.i_block[i];
-			if (!blk || read_block(blk, buf) < 0) continue;
-            int off = 0;
-            while (off < block_size) {
-                ext2_dir_entry_2 *e = (ext2_dir_entry_2*)(buf + off);
-                if (e->inode) {
-                    char name[EXT2_NAME_LEN+1] = {0};
-                    memcpy(name, e->name, e->name_len);
-                    if (strcmp(name, tok) == 0) {
-                        cur_ino = e->inode;
-                        read_inode(cur_ino, &cur);
-                        found = 1;
-                        break;
-                    }
-                }
-                off += e->rec_len;
-            }
-        }
-        free(buf);
-        if (!found) break;
-        tok = strtok(NULL, "/");
-    }
-    free(copy);
-    if (tok) return -1;
-    *inode = cur;
-    return cur_ino;
+	fprintf(OUT, "Usage : tree <PATH> [OPTION]...\n");
 }
 
 // format_permissions: build permission string
@@ -235,8 +291,8 @@ static void format_permissions(uint16_t mode, char *buf) {
 }
 
 // format_size: file size in bytes
-static void format_size(uint32_t size, char *buf) {
-    sprintf(buf, "%u", size);
+static void format_size(uint64_t size, char *buf) {
+    sprintf(buf, "%" PRIu64, size);
 }
 
 // cmd_tree: entry point for tree command
@@ -256,27 +312,55 @@ void cmd_tree(int argc, char *argv[]) {
             else { help(); return; }
         }
     }
-    // clear old list
-    clear_tree_list();
     // validate path
     ext2_inode root;
-    if (get_inode_by_path(path, &root) < 0) { help(); return; }
-    if (!is_dir(&root)) { fprintf(stderr, "Error: '%s' is not directory\n", path); return; }
-
-    // print and recurse
-    printf("%s\n", path);
-    build_tree(path, 0, recursive);
-	print_nodes(show_size, show_perm);
-	
+    int ino = get_inode_by_path(path, &root);
+    if (ino < 0) { help(); return; }
+    if (!is_dir(&root)) { fprintf(ERR, "Error: '%s' is not directory\n", path); return; }
+
+    // replay a cached walk; a recursive one also answers a one-level request
+    pthread_mutex_lock(&tree_lock);
+    TreeEntry *e = cache_find(ino, &root, recursive);
+    if (!e && !recursive) e = cache_find(ino, &root, 1);
+    TreeEntry hit = e ? *e : (TreeEntry){ 0 };
+    if (e) e->list->refs++;
+    pthread_mutex_unlock(&tree_lock);
+
+    if (e) {
+        STAT_ADD(tree_hits, 1);
+    } else {
+        // walk, then cache the request and every subdirectory it walked
+        NodeList *list = calloc(1, sizeof(*list));
+        if (!list) { perror("calloc"); exit(EXIT_FAILURE); }
+        PendingList pend = { NULL, 0, 0 };
+        build_tree(&root, 0, recursive, list, &pend);
+        add_pending(&pend, &(Pending){ (uint32_t)ino, root, recursive, 0, list->count, 0 });
+        hit = (TreeEntry){ .recursive = recursive, .list = list, .count = list->count };
+        pthread_mutex_lock(&tree_lock);
+        list->refs++;
+        cache_store(list, &pend);
+        pthread_mutex_unlock(&tree_lock);
+        free(pend.v);
+    }
+    const TreeNode *nodes = hit.list->v + hit.start;
+    int top_only = hit.recursive && !recursive;
+
+    // print
+    fprintf(OUT, "%s\n", path);
+    print_nodes(nodes, hit.count, hit.base, top_only, show_size, show_perm);
+
 	// number of directory and files
 	int dir_count = 1;
 	int file_count = 0;
-	for (TreeNode *cur = list_head; cur; cur = cur->next) {
+	for (const TreeNode *cur = nodes; cur < nodes + hit.count; cur++) {
+	    if (top_only && cur->depth > hit.base) continue;
 	    if (is_dir(&cur->inode)) dir_count++;
 		else file_count++;
 	}
-	printf("\n%d directories, %d files\n\n", dir_count, file_count);
+	fprintf(OUT, "\n%d directories, %d files\n\n", dir_count, file_count);
 
-    // Clean up node list
-	clear_tree_list();
+    // Release the nodes
+    pthread_mutex_lock(&tree_lock);
+    list_release(hit.list);
+    pthread_mutex_unlock(&tree_lock);
 }
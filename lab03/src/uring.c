@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "header.h"
+
+#define URING_ENTRIES 64
+
+/* -- Prototypes -- */
+static int ring_setup(unsigned entries, struct io_uring_params *p);
+static int ring_enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+static void ring_teardown(void);
+static int pread_reqs(read_req *reqs, int n, const unsigned char *done);
+static int reap(read_req *reqs, unsigned char *done, int *ret);
+static int submit_and_reap(read_req *reqs, int n);
+
+/* -- Ring state (one ring shared by the whole process) -- */
+static int ring_fd = -1;
+static void *sq_ptr, *cq_ptr;
+static size_t sq_len, cq_len;
+static struct io_uring_sqe *sqes;
+static size_t sqes_len;
+static unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+static unsigned *cq_head, *cq_tail, *cq_mask;
+static struct io_uring_cqe *cqes;
+static unsigned ring_entries;
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int use_uring = 0;
+
+// ring_setup: io_uring_setup(2) without liburing
+static int ring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+// ring_enter: io_uring_enter(2) without liburing
+static int ring_enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+// uring_init: create the ring and map its queues; -1 if the kernel refuses
+int uring_init(unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    if (entries == 0) entries = URING_ENTRIES;
+
+    ring_fd = ring_setup(entries, &p);
+    if (ring_fd < 0) return -1;
+
+    sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_len > sq_len) sq_len = cq_len;
+        cq_len = sq_len;
+    }
+    sq_ptr = mmap(NULL, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ptr = sq_ptr;
+    } else {
+        cq_ptr = mmap(NULL, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) { munmap(sq_ptr, sq_len); goto fail; }
+    }
+    sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = mmap(NULL, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        munmap(sq_ptr, sq_len);
+        if (cq_ptr != sq_ptr) munmap(cq_ptr, cq_len);
+        goto fail;
+    }
+
+    sq_head  = (unsigned *)((char *)sq_ptr + p.sq_off.head);
+    sq_tail  = (unsigned *)((char *)sq_ptr + p.sq_off.tail);
+    sq_mask  = (unsigned *)((char *)sq_ptr + p.sq_off.ring_mask);
+    sq_array = (unsigned *)((char *)sq_ptr + p.sq_off.array);
+    cq_head  = (unsigned *)((char *)cq_ptr + p.cq_off.head);
+    cq_tail  = (unsigned *)((char *)cq_ptr + p.cq_off.tail);
+    cq_mask  = (unsigned *)((char *)cq_ptr + p.cq_off.ring_mask);
+    cqes     = (struct io_uring_cqe *)((char *)cq_ptr + p.cq_off.cqes);
+    ring_entries = p.sq_entries;
+    use_uring = 1;
+    return 0;
+
+fail:
+    close(ring_fd);
+    ring_fd = -1;
+    return -1;
+}
+
+// ring_teardown: unmap and close the ring; caller holds ring_lock or is the last user
+static void ring_teardown(void) {
+    if (ring_fd < 0) return;
+    munmap(sqes, sqes_len);
+    if (cq_ptr != sq_ptr) munmap(cq_ptr, cq_len);
+    munmap(sq_ptr, sq_len);
+    close(ring_fd);
+    ring_fd = -1;
+    __atomic_store_n(&use_uring, 0, __ATOMIC_RELAXED);
+}
+
+// uring_exit: tear down the ring
+void uring_exit(void) {
+    pthread_mutex_lock(&ring_lock);
+    ring_teardown();
+    pthread_mutex_unlock(&ring_lock);
+}
+
+// pread_reqs: the blocking fallback for requests the ring did not finish
+static int pread_reqs(read_req *reqs, int n, const unsigned char *done) {
+    int ret = 0;
+    for (int i = 0; i < n; i++) {
+        if (done && done[i]) continue;
+        if (image_pread(reqs[i].buf, reqs[i].len, reqs[i].off) != (ssize_t)reqs[i].len)
+            ret = -1;
+    }
+    return ret;
+}
+
+// reap: consume every posted completion; returns how many were reaped
+static int reap(read_req *reqs, unsigned char *done, int *ret) {
+    int reaped = 0;
+    unsigned head = *cq_head;
+    while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &cqes[head & *cq_mask];
+        read_req *r = &reqs[cqe->user_data];
+        // finish short reads synchronously
+        size_t got = cqe->res > 0 ? (size_t)cqe->res : 0;
+        STAT_ADD(bytes_read, got);
+        if (cqe->res < 0) {
+            *ret = -1;
+        } else if (got < r->len) {
+            ssize_t m = image_pread((char *)r->buf + got, r->len - got, r->off + got);
+            if (m != (ssize_t)(r->len - got)) *ret = -1;
+        }
+        done[cqe->user_data] = 1;
+        head++;
+        reaped++;
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    return reaped;
+}
+
+// submit_and_reap: queue n (<= ring_entries) reads, wait for all of them.
+// If the ring itself fails, nothing of this batch is left behind: unsubmitted
+// entries are withdrawn, in-flight reads are waited for, the ring is torn down
+// and the rest is read with pread.
+static int submit_and_reap(read_req *reqs, int n) {
+    unsigned char done[URING_ENTRIES];
+    memset(done, 0, n);
+    unsigned start = *sq_tail;
+    unsigned tail = start;
+    for (int i = 0; i < n; i++) {
+        unsigned idx = tail & *sq_mask;
+        struct io_uring_sqe *sqe = &sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fs_fd;
+        sqe->off = reqs[i].off;
+        sqe->addr = (uint64_t)(uintptr_t)reqs[i].buf;
+        sqe->len = reqs[i].len;
+        sqe->user_data = i;
+        sq_array[idx] = idx;
+        tail++;
+    }
+    __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+    int ret = 0, reaped = 0, submitted = 0;
+    while (reaped < n) {
+        int rc = ring_enter(n - submitted, 1, IORING_ENTER_GETEVENTS);
+        STAT_ADD(syscalls, 1);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        submitted += rc;
+        reaped += reap(reqs, done, &ret);
+    }
+    if (reaped == n) return ret;
+
+    // the ring failed: withdraw what the kernel has not consumed
+    submitted = (int)(__atomic_load_n(sq_head, __ATOMIC_ACQUIRE) - start);
+    __atomic_store_n(sq_tail, start + submitted, __ATOMIC_RELEASE);
+    // wait for reads still writing into the caller's buffers
+    while (reaped < submitted) {
+        reaped += reap(reqs, done, &ret);
+        if (reaped == submitted) break;
+        int rc = ring_enter(0, 1, IORING_ENTER_GETEVENTS);
+        STAT_ADD(syscalls, 1);
+        if (rc < 0 && errno != EINTR) break;
+    }
+    ring_teardown();
+    if (pread_reqs(reqs, n, done) < 0) ret = -1;
+    return ret;
+}
+
+// uring_read_batch: read every request through the ring, ring_entries at a time
+int uring_read_batch(read_req *reqs, int n) {
+    int ret = 0;
+    for (int i = 0; i < n; i++)
+        STAT_ADD(blocks_read, reqs[i].len / block_size);
+    pthread_mutex_lock(&ring_lock);
+    for (int done = 0; done < n; ) {
+        int max = ring_entries < URING_ENTRIES ? (int)ring_entries : URING_ENTRIES;
+        int chunk = n - done < max ? n - done : max;
+        // the ring may have been torn down by an earlier chunk or another thread
+        if (ring_fd < 0) chunk = n - done;
+        int rc = ring_fd < 0 ? pread_reqs(reqs + done, chunk, NULL)
+                             : submit_and_reap(reqs + done, chunk);
+        if (rc < 0) ret = -1;
+        done += chunk;
+    }
+    pthread_mutex_unlock(&ring_lock);
+    return ret;
+}
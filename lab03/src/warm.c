@@ -0,0 +1,173 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "header.h"
+
+#define EXT2_ROOT_INO    2
+#define WARM_RUN         64          // most blocks fetched by one read
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_SHIFT 13
+
+/* -- One block to prefetch -- */
+typedef struct {
+    uint32_t blk;
+    int kind;                        // TRACE_INODE or TRACE_DIR
+} WarmBlock;
+
+static pthread_t warm_tid;
+static int warm_running = 0;
+static int warm_stopping = 0;
+static int fg_active = 0;            // foreground commands in progress
+static pthread_mutex_t warm_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t warm_cond = PTHREAD_COND_INITIALIZER;
+
+/* -- Prototypes -- */
+static void lower_priority(void);
+static int wait_idle(void);
+static int add_block(WarmBlock **list, uint32_t *n, uint32_t *cap, uint32_t blk, int kind);
+static int cmp_warm(const void *a, const void *b);
+static uint32_t collect_blocks(WarmBlock **out);
+static void *warm_main(void *arg);
+
+// lower_priority: lowest CPU and idle-class I/O priority for this thread only
+static void lower_priority(void) {
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    setpriority(PRIO_PROCESS, tid, 19);
+#ifdef SYS_ioprio_set
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+#endif
+}
+
+// wait_idle: block while a foreground command runs; 1 when asked to stop
+static int wait_idle(void) {
+    pthread_mutex_lock(&warm_lock);
+    while (fg_active > 0 && !warm_stopping)
+        pthread_cond_wait(&warm_cond, &warm_lock);
+    int stop = warm_stopping;
+    pthread_mutex_unlock(&warm_lock);
+    return stop;
+}
+
+static int add_block(WarmBlock **list, uint32_t *n, uint32_t *cap, uint32_t blk, int kind) {
+    if (*n == *cap) {
+        uint32_t c = *cap ? *cap * 2 : 1024;
+        WarmBlock *p = realloc(*list, (size_t)c * sizeof(WarmBlock));
+        if (!p) return -1;
+        *list = p;
+        *cap = c;
+    }
+    (*list)[(*n)++] = (WarmBlock){ blk, kind };
+    return 0;
+}
+
+static int cmp_warm(const void *a, const void *b) {
+    uint32_t x = ((const WarmBlock *)a)->blk, y = ((const WarmBlock *)b)->blk;
+    return x < y ? -1 : x > y;
+}
+
+// collect_blocks: the root directory's blocks, then the inode table blocks
+// holding allocated inodes group by group, up to what the cache can hold;
+// returned in physical order
+static uint32_t collect_blocks(WarmBlock **out) {
+    uint32_t limit = cache_capacity();
+    uint32_t n = 0, cap = 0;
+    WarmBlock *list = NULL;
+
+    ext2_inode root;
+    block_iter it;
+    if (read_inode(EXT2_ROOT_INO, &root) == 0 && biter_init(&it, &root) == 0) {
+        uint64_t lblk;
+        uint32_t pblk, len;
+        while (n < limit && biter_next(&it, &lblk, &pblk, &len, WARM_RUN) > 0) {
+            for (uint32_t i = 0; pblk && i < len && n < limit; i++)
+                if (add_block(&list, &n, &cap, pblk + i, TRACE_DIR) < 0) break;
+        }
+        biter_free(&it);
+    }
+
+    char *bitmap = malloc(block_size);
+    uint32_t per_block = (uint32_t)(block_size / inode_size);
+    for (uint32_t g = 0; bitmap && g < group_count && n < limit; g++) {
+        if (wait_idle()) break;
+        if (read_blocks_as(gdt[g].bg_inode_bitmap, 1, bitmap, TRACE_META) < 0) continue;
+        // table blocks up to the last allocated inode of the group
+        int64_t last = -1;
+        for (int64_t i = (int64_t)sb.s_inodes_per_group - 1; i >= 0; i--)
+            if ((bitmap[i / 8] >> (i % 8)) & 1) { last = i; break; }
+        uint32_t used = (uint32_t)((last + 1 + per_block - 1) / per_block);
+        for (uint32_t b = 0; b < used && n < limit; b++)
+            if (add_block(&list, &n, &cap, gdt[g].bg_inode_table + b, TRACE_INODE) < 0) break;
+    }
+    free(bitmap);
+
+    if (n > 1) qsort(list, n, sizeof(WarmBlock), cmp_warm);
+    *out = list;
+    return n;
+}
+
+// warm_main: stream the collected blocks into the block cache, one run of
+// physically contiguous blocks per read, pausing whenever a command runs
+static void *warm_main(void *arg) {
+    (void)arg;
+    lower_priority();
+    if (tracing) trace_command("warm", 1);
+
+    WarmBlock *list = NULL;
+    uint32_t n = collect_blocks(&list);
+    char *buf = malloc((size_t)WARM_RUN * block_size);
+    for (uint32_t i = 0; buf && i < n; ) {
+        uint32_t run = 1;
+        while (i + run < n && run < WARM_RUN && list[i + run].blk == list[i].blk + run &&
+               list[i + run].kind == list[i].kind)
+            run++;
+        if (wait_idle()) break;
+        if (read_blocks_as(list[i].blk, run, buf, list[i].kind) == 0)
+            for (uint32_t j = 0; j < run; j++)
+                if (cache_fill(list[i].blk + j, buf + (size_t)j * block_size))
+                    STAT_ADD(warm_blocks, 1);
+        i += run;
+    }
+    free(buf);
+    free(list);
+    return NULL;
+}
+
+// warm_start: begin warming the block cache of the open image in the background
+int warm_start(void) {
+    warm_stopping = 0;
+    if (pthread_create(&warm_tid, NULL, warm_main, NULL) != 0) {
+        fprintf(stderr, "Error: cannot start the warm-up thread\n");
+        return -1;
+    }
+    warm_running = 1;
+    return 0;
+}
+
+// warm_stop: stop the warm-up thread, if any, and wait for it
+void warm_stop(void) {
+    if (!warm_running) return;
+    pthread_mutex_lock(&warm_lock);
+    warm_stopping = 1;
+    pthread_cond_broadcast(&warm_cond);
+    pthread_mutex_unlock(&warm_lock);
+    pthread_join(warm_tid, NULL);
+    warm_running = 0;
+}
+
+// warm_hold: a foreground command starts; the warmer waits until none runs
+void warm_hold(void) {
+    pthread_mutex_lock(&warm_lock);
+    fg_active++;
+    pthread_mutex_unlock(&warm_lock);
+}
+
+// warm_release: a foreground command finished
+void warm_release(void) {
+    pthread_mutex_lock(&warm_lock);
+    if (--fg_active == 0) pthread_cond_broadcast(&warm_cond);
+    pthread_mutex_unlock(&warm_lock);
+}